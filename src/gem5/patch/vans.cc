@@ -19,8 +19,10 @@ VANS::VANS(const Params *p) :
     read_callback(bind(&VANS::readComplete, this, std::placeholders::_1, 0)),
     write_callback(bind(&VANS::writeComplete, this, std::placeholders::_1, 0)),
     ticks_per_clk(0),
+    clk0_tick(0),
     resp_stall(false),
     req_stall(false),
+    sleeping(false),
     send_resp_event([this] { sendResponse(); }, name()),
     tick_event([this] { tick(); }, name())
 {
@@ -60,7 +62,8 @@ void VANS::init()
 
 void VANS::startup()
 {
-    schedule(tick_event, clockEdge());
+    clk0_tick = clockEdge();
+    schedule(tick_event, clk0_tick);
 }
 
 DrainState VANS::drain()
@@ -107,6 +110,8 @@ void VANS::sendResponse()
 
 void VANS::tick()
 {
+    /* Skip the idle clks before a periodic event of the model, e.g. a refresh */
+    wrapper->advance_to(tickToClk(curTick()));
     wrapper->tick();
 
     if (req_stall) {
@@ -114,7 +119,33 @@ void VANS::tick()
         port.sendRetryReq();
     }
 
-    schedule(tick_event, curTick() + ticks_per_clk);
+    scheduleTick();
+}
+
+/* Tick every clk while requests are in flight, otherwise sleep until the next periodic event of the model or the next
+ * request, see `wakeUp` */
+void VANS::scheduleTick()
+{
+    if (tick_event.scheduled())
+        return;
+
+    clk_t next = wrapper->next_event_clk();
+    sleeping   = next != wrapper->get_clk();
+    if (next != vans::clk_invalid)
+        schedule(tick_event, clkToTick(next));
+}
+
+/* A request to a sleeping model: skip the idle clks and tick from the next clk edge on */
+void VANS::wakeUp()
+{
+    if (!sleeping)
+        return;
+
+    sleeping = false;
+    if (tick_event.scheduled())
+        deschedule(tick_event);
+    wrapper->advance_to(tickToClk(curTick()));
+    schedule(tick_event, clkToTick(wrapper->get_clk()));
 }
 
 
@@ -148,6 +179,9 @@ bool VANS::recvTimingReq(PacketPtr pkt)
 
     bool accepted = true;
 
+    if (pkt->isRead() || pkt->isWrite())
+        wakeUp();
+
     vans::logic_addr_t addr = pkt->getAddr();
 
     if (pkt->isRead()) {
@@ -79,16 +79,32 @@ class VANS : public AbstractMemory
     std::function<void(logic_addr_t, clk_t)> write_callback;
 
     Tick ticks_per_clk;
+    Tick clk0_tick;
     bool resp_stall;
     bool req_stall;
+    /* No tick is due before the next request or the next periodic event of the model, see `scheduleTick` */
+    bool sleeping;
 
     unsigned int num_outstanding() const
     {
         return reqs_in_flight + resp_queue.size();
     }
 
+    Tick clkToTick(clk_t clk) const
+    {
+        return clk0_tick + clk * ticks_per_clk;
+    }
+
+    /* The first clk whose edge is at or after `when` */
+    clk_t tickToClk(Tick when) const
+    {
+        return when <= clk0_tick ? 0 : (when - clk0_tick + ticks_per_clk - 1) / ticks_per_clk;
+    }
+
     void sendResponse();
     void tick();
+    void scheduleTick();
+    void wakeUp();
 
     EventFunctionWrapper send_resp_event;
     EventFunctionWrapper tick_event;
@@ -41,6 +41,27 @@ bool gem5_wrapper::send(vans::base_request req)
     return std::get<0>(resp);
 }
 
+bool gem5_wrapper::quiescent()
+{
+    return !this->memory->pending();
+}
+
+clk_t gem5_wrapper::next_event_clk()
+{
+    if (!this->quiescent())
+        return this->curr_clk;
+    return this->memory->next_event(this->curr_clk);
+}
+
+void gem5_wrapper::advance_to(clk_t clk)
+{
+    if (clk <= this->curr_clk)
+        return;
+    /* Ticking the last skipped clk brings the controller clks and the arrive clks of the components up to date */
+    this->curr_clk = clk - 1;
+    this->tick();
+}
+
 void gem5_wrapper::finish()
 {
     this->memory->drain();
@@ -34,6 +34,17 @@ class gem5_wrapper
     {
         return this->curr_clk;
     }
+
+    /* Event skipping: an idle model only needs ticks for its periodic work (e.g. DRAM refresh)
+     *   quiescent     : no request is in flight
+     *   next_event_clk: the clk of the next tick the model needs, the current clk while not quiescent, `clk_invalid`
+     *                   if nothing is due until the next request
+     *   advance_to    : skip the clks before `clk` without ticking them, only while quiescent and up to
+     *                   `next_event_clk`
+     */
+    bool quiescent();
+    clk_t next_event_clk();
+    void advance_to(clk_t clk);
 };
 
 } // namespace vans
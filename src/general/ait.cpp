@@ -11,6 +11,7 @@ void ait_controller::init_state_trans_table()
         [this](const decltype(this->get_next_level(addr_invalid)) &next, buffer_entry &entry, clk_t curr_clk) {
             block_addr_t blk_addr = translate_to_block_addr(entry.pending_request.rmw_block_addr);
             base_request req{vans::base_request_type::read, blk_addr, curr_clk, this->next_level_read_callback};
+            req.sample           = entry.sample;
             auto &next_component = std::get<1>(next);
             return next_component->issue_request(req);
         };
@@ -18,23 +19,27 @@ void ait_controller::init_state_trans_table()
         [this](const decltype(this->get_next_level(addr_invalid)) &next, buffer_entry &entry, clk_t curr_clk) {
             block_addr_t blk_addr = translate_to_block_addr(entry.pending_request.rmw_block_addr);
             base_request req{vans::base_request_type::write, blk_addr, curr_clk, this->next_level_read_callback};
+            req.sample           = entry.sample;
             auto &next_component = std::get<1>(next);
             return next_component->issue_request(req);
         };
 
     const auto issue_lmemq = [this](buffer_entry &entry, base_request_type type, clk_t curr_clk) -> base_response {
         base_request req{type, entry.pending_request.rmw_block_addr, curr_clk, nullptr};
+        req.sample  = entry.sample;
         bool issued = this->lmemq.enqueue(req);
         return {(issued), false, clk_invalid};
     };
 
     const auto issue_write_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
         base_request req{base_request_type::write, entry.pending_request.rmw_block_addr, curr_clk, nullptr};
+        req.sample = entry.sample;
         return this->local_memory_model->issue_request(req);
     };
 
     const auto issue_read_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
         base_request req{base_request_type::read, entry.pending_request.rmw_block_addr, curr_clk, nullptr};
+        req.sample = entry.sample;
         return this->local_memory_model->issue_request(req);
     };
 
@@ -379,6 +384,7 @@ void ait_controller::tick_lsq_read(clk_t curr_clk)
     }
 
     if (req_served) {
+        entry_pair->second.sample = front_req.sample;
         entry_pair->second.assign_callback(front_req.callback);
         lsq.queue.pop_front();
         cnt_events["read_access"]++;
@@ -414,6 +420,7 @@ void ait_controller::tick_lsq_write(clk_t curr_clk)
 
     if (write_issued) {
         this->table.record_write(rmw_addr);
+        entry_pair->second.sample = front_req.sample;
         entry_pair->second.assign_callback(front_req.callback);
         lsq.queue.pop_front();
         cnt_events["write_access"]++;
@@ -447,7 +454,11 @@ void ait_controller::tick_internal_buffer(clk_t curr_clk)
         if (func == nullptr) {
             throw std::runtime_error("Internal error, unknown state transfer.");
         }
+        auto prev_state = entry.state;
         func(curr_block_addr, entry, curr_clk);
+        if (this->tracer && entry.state != prev_state && this->tracer->sampled(entry.sample, curr_block_addr)) {
+            this->tracer->instant(this->trace_track, request_state_name[int(entry.state)], curr_block_addr, curr_clk);
+        }
     }
 }
 
@@ -460,14 +471,7 @@ bool ait_controller::check_and_evict()
         return false;
 
     /* LRU eviction */
-    block_addr_t oldest_addr = addr_invalid;
-    clk_t oldest_clk         = clk_invalid;
-    for (auto &entry : buffer.entry_map) {
-        if (entry.second.state == request_state::end && entry.second.last_used_clk < oldest_clk) {
-            oldest_clk  = entry.second.last_used_clk;
-            oldest_addr = entry.first;
-        }
-    }
+    block_addr_t oldest_addr = buffer.lru_entry(idle_entry);
 
     if (oldest_addr == addr_invalid) {
         /* All busy, cannot evict */
@@ -479,6 +483,42 @@ bool ait_controller::check_and_evict()
     }
 }
 
+/* ait::ait_controller::warm()
+ *   Leave the block in the buffer as a finished request would, and count writes in the indirection table.
+ *   Reads and writes of the media have no state to warm.
+ */
+void ait_controller::warm(const base_request &req)
+{
+    bool is_write   = req.type == base_request_type::write;
+    auto rmw_addr   = vans::rmw::translate_to_block_addr(req.addr);
+    auto ait_addr   = vans::ait::translate_to_block_addr(rmw_addr);
+    auto entry_pair = this->buffer.find(ait_addr);
+    if (entry_pair == this->buffer.end()) {
+        if (this->buffer.full()) {
+            auto victim = this->buffer.lru_entry(idle_entry);
+            if (victim == addr_invalid)
+                throw std::runtime_error("Internal error, warming an ait with every entry in flight.");
+            this->buffer.erase(victim);
+        }
+        entry_pair = this->buffer.insert(ait_addr,
+                                         req.arrive,
+                                         is_write ? request_type::write_miss : request_type::read_miss,
+                                         rmw_addr,
+                                         vans::ait::block_bitshift_rmw(rmw_addr));
+    }
+    if (is_write)
+        this->table.record_write(rmw_addr);
+
+    auto &entry                     = entry_pair->second;
+    entry.pending                   = false;
+    entry.waiting_action_clk_update = false;
+    entry.valid_to_read             = true;
+    entry.dirty                     = false;
+    entry.state                     = request_state::end;
+    entry.last_used_clk             = req.arrive;
+    entry.next_action_clk           = req.arrive;
+}
+
 void ait_controller::tick_lmemq(clk_t curr_clk)
 {
     if (lmemq.empty())
@@ -536,12 +576,13 @@ void ait_controller::tick_lmemq(clk_t curr_clk)
         };
 
         base_request req(req_type, cl_addr, curr_clk, callback);
+        req.sample = front_req.sample;
 
         auto [issued, deterministic, next_clk] = this->local_memory_model->issue_request(req);
 
         if (!issued) {
-            throw std::runtime_error(
-                "AIT controller feature not implemented: ait do not retry issuing request to local memory");
+            /* The channel of this sub request is full, retry it next cycle */
+            lmemq_state.subreq_pending_index--;
         } else {
             if (req_type == base_request_type::write) {
                 callback(cl_addr, curr_clk);
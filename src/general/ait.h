@@ -2,8 +2,8 @@
 #define VANS_AIT_H
 
 #include "buffer.h"
-#include "ddr4.h"
 #include "dram_memory.h"
+#include "factory.h"
 #include "request_queue.h"
 #include "static_memory.h"
 #include "utils.h"
@@ -25,6 +25,17 @@ enum class request_state {
     total
 };
 
+/* Names of `request_state`, for span traces */
+static const char *const request_state_name[] = {
+    "init",
+    "pending_read_media",
+    "pending_write_media",
+    "pending_read_dram",
+    "pending_write_dram",
+    "pending_migration",
+    "end",
+};
+
 struct request {
     request_type type;
     vans::rmw::block_addr_t rmw_block_addr;
@@ -70,6 +81,7 @@ struct buffer_entry {
     /* Pending requests */
     request pending_request;
     request_state state = request_state::init;
+    trace_sample sample = trace_sample::undecided; /* Of the requests served, not saved in checkpoints */
 
     /* Methods */
     buffer_entry() = delete;
@@ -110,8 +122,31 @@ struct buffer_entry {
     {
         this->cb = nullptr;
     }
+
+    void serialize(checkpoint &ckpt)
+    {
+        ckpt.expect_idle(!pending, "a pending ait buffer entry");
+        bool flags[4] = {pending, waiting_action_clk_update, valid_to_read, dirty};
+        ckpt.io(flags);
+        pending                   = flags[0];
+        waiting_action_clk_update = flags[1];
+        valid_to_read             = flags[2];
+        dirty                     = flags[3];
+        ckpt.io(last_used_clk);
+        ckpt.io(next_action_clk);
+        ckpt.io(buffer_index);
+        ckpt.io(rmw_bitmap);
+        ckpt.io(pending_request);
+        ckpt.io(state);
+    }
 };
 
+/* Only finished entries can be evicted */
+static inline bool idle_entry(const buffer_entry &entry)
+{
+    return entry.state == request_state::end;
+}
+
 struct table_entry {
     size_t write_cnt;
     table_entry() : write_cnt(0) {}
@@ -155,7 +190,7 @@ struct indirection_table {
     }
 };
 
-class ait_controller : public memory_controller<vans::base_request, vans::dram::ddr::ddr4_memory>
+class ait_controller : public memory_controller<vans::base_request, base_component>
 {
   public:
     internal_buffer<block_addr_t,
@@ -225,7 +260,7 @@ class ait_controller : public memory_controller<vans::base_request, vans::dram::
 
   public:
     ait_controller() = delete;
-    explicit ait_controller(const config &cfg, std::shared_ptr<vans::dram::ddr::ddr4_memory> memory) :
+    explicit ait_controller(const config &cfg, std::shared_ptr<base_component> memory) :
         memory_controller(cfg),
         lsq(cfg.get_ulong("lsq_entries")),
         lmemq(cfg.get_ulong("lmemq_entries")),
@@ -247,6 +282,20 @@ class ait_controller : public memory_controller<vans::base_request, vans::dram::
 
     bool check_and_evict();
 
+    void warm(const base_request &req) final;
+
+    void reconfigure(const config &cfg) final
+    {
+        table.wear_leveling_threshold = cfg.get_ulong("wear_leveling_threshold");
+        table.migration_block_entries = cfg.get_ulong("migration_block_entries");
+        table.migration_latency       = cfg.get_ulong("migration_latency");
+    }
+
+    [[nodiscard]] std::vector<std::string> reconfigure_keys(const config &cfg) const final
+    {
+        return {"wear_leveling_threshold", "migration_block_entries", "migration_latency"};
+    }
+
     void drain_current() final;
 
     void tick(clk_t curr_clk) override;
@@ -267,6 +316,26 @@ class ait_controller : public memory_controller<vans::base_request, vans::dram::
         this->cnt_duration.print(this->counter_dumper);
     }
 
+    void register_stats(stats_registry &stats, const std::string &component) final
+    {
+        stats.add_counter(component, this->cnt_events);
+        stats.add_counter(component, this->cnt_duration);
+        stats.add_gauge(component + ".lsq", [this]() { return this->lsq.size(); });
+        stats.add_gauge(component + ".lmemq", [this]() { return this->lmemq.size(); });
+        stats.add_gauge(component + ".buffer", [this]() { return this->buffer.entry_map.size(); });
+    }
+
+    void serialize(checkpoint &ckpt) final
+    {
+        ckpt.expect_idle(lsq.empty() && lmemq.empty(), "ait");
+        ckpt.io(buffer);
+        ckpt.io(table.table);
+        ckpt.io(lmemq_state);
+        ckpt.io(evicting);
+        ckpt.io(cnt_events);
+        ckpt.io(cnt_duration);
+    }
+
   private:
     void tick_lsq(clk_t curr_clk);
     void tick_lsq_read(clk_t curr_clk);
@@ -275,18 +344,18 @@ class ait_controller : public memory_controller<vans::base_request, vans::dram::
     void tick_internal_buffer(clk_t curr_clk);
 };
 
-class ait : public component<ait_controller, vans::dram::ddr::ddr4_memory>
+class ait : public component<ait_controller, base_component>
 {
   public:
     ait() = delete;
     explicit ait(const config &cfg) : component(cfg)
     {
-        this->memory_component = std::make_shared<vans::dram::ddr::ddr4_memory>(cfg);
+        this->memory_component = factory::make_dram_memory(cfg);
         this->ctrl             = std::make_shared<ait_controller>(cfg, this->memory_component);
     }
     base_response issue_request(base_request &req) override
     {
-        return this->ctrl->issue_request(req);
+        return this->issue_tracked_request(req);
     }
 };
 
@@ -0,0 +1,109 @@
+#ifndef VANS_ASYNC_WRITER_H
+#define VANS_ASYNC_WRITER_H
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vans
+{
+
+/* Buffered file writer, full buffers are written by a background thread
+ *   Writes append to the active buffer. A full buffer is swapped with the idle one and handed to the writer thread,
+ *   the simulation only waits if the previous buffer is still being written. The thread starts with the first full
+ *   buffer, so small files (e.g. stats) are written once at destruction without a thread.
+ */
+class async_writer
+{
+  private:
+    std::ofstream file;
+    size_t capacity;
+    std::vector<char> active;
+    std::vector<char> flushing;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool flush_pending = false;
+    bool stop          = false;
+    std::thread worker;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this] { return flush_pending || stop; });
+            if (flush_pending) {
+                lock.unlock();
+                file.write(flushing.data(), std::streamsize(flushing.size()));
+                flushing.clear();
+                lock.lock();
+                flush_pending = false;
+                cv.notify_all();
+                continue;
+            }
+            break;
+        }
+    }
+
+    void swap_out()
+    {
+        if (!worker.joinable())
+            worker = std::thread(&async_writer::run, this);
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return !flush_pending; });
+        std::swap(active, flushing);
+        flush_pending = true;
+        cv.notify_all();
+    }
+
+  public:
+    async_writer()                     = delete;
+    async_writer(const async_writer &) = delete;
+    async_writer &operator=(const async_writer &) = delete;
+
+    explicit async_writer(const std::string &filename, size_t capacity = 4 << 20) :
+        file(filename, std::ios::binary), capacity(capacity)
+    {
+        if (!file.good())
+            throw std::runtime_error("cannot open dump file: " + filename);
+        active.reserve(capacity);
+        flushing.reserve(capacity);
+    }
+
+    ~async_writer()
+    {
+        if (worker.joinable()) {
+            swap_out();
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stop = true;
+            }
+            cv.notify_all();
+            worker.join();
+        } else {
+            file.write(active.data(), std::streamsize(active.size()));
+        }
+    }
+
+    void write(const void *data, size_t size)
+    {
+        if (active.size() + size > capacity && !active.empty())
+            swap_out();
+        auto bytes = static_cast<const char *>(data);
+        active.insert(active.end(), bytes, bytes + size);
+    }
+
+    void write(const std::string &str)
+    {
+        write(str.data(), str.size());
+    }
+};
+
+} // namespace vans
+
+#endif // VANS_ASYNC_WRITER_H
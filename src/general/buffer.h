@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <stdexcept>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "utils.h"
 
@@ -73,6 +75,20 @@ template <typename AddrType, typename EntryType, auto AddrFunc, typename... ArgT
         return entry_map.erase(AddrFunc(logic_addr));
     }
 
+    /* Address of the least recently used entry that `evictable` accepts, `addr_invalid` if there is none */
+    template <typename Pred> AddrType lru_entry(Pred evictable)
+    {
+        AddrType oldest_addr = addr_invalid;
+        clk_t oldest_clk     = clk_invalid;
+        for (auto &entry : entry_map) {
+            if (evictable(entry.second) && entry.second.last_used_clk < oldest_clk) {
+                oldest_clk  = entry.second.last_used_clk;
+                oldest_addr = entry.first;
+            }
+        }
+        return oldest_addr;
+    }
+
     bool full()
     {
         return entry_map.size() >= max_entries;
@@ -92,6 +108,40 @@ template <typename AddrType, typename EntryType, auto AddrFunc, typename... ArgT
     {
         return std::any_of(entry_map.begin(), entry_map.end(), [](const auto &entry) { return entry.second.dirty; });
     }
+
+    /* Iteration order decides which entry is served or evicted first, so entries are saved in reverse order:
+     * inserting them in that order into the same number of buckets rebuilds the same iteration order (libstdc++).
+     */
+    void serialize(checkpoint &ckpt)
+    {
+        ckpt.io(this->next_available_index);
+        size_t size = entry_map.size();
+        ckpt.io(size);
+        if (ckpt.saving()) {
+            std::vector<std::pair<AddrType, EntryType *>> entries;
+            for (auto &[addr, entry] : entry_map)
+                entries.emplace_back(addr, &entry);
+            for (auto it = entries.rbegin(); it != entries.rend(); it++) {
+                ckpt.io(it->first);
+                ckpt.io(*it->second);
+            }
+            return;
+        }
+
+        if (size > max_entries) {
+            throw std::runtime_error("checkpoint buffer has " + std::to_string(size) + " entries, more than "
+                                     + std::to_string(max_entries) + " buffer entries.");
+        }
+        entry_map.clear();
+        for (size_t i = 0; i < size; i++) {
+            AddrType addr;
+            ckpt.io(addr);
+            /* Entries are constructed with placeholder arguments, then every field is restored */
+            auto ret = entry_map.emplace(
+                std::piecewise_construct, std::forward_as_tuple(addr), std::forward_as_tuple(ArgTypes{}...));
+            ckpt.io(ret.first->second);
+        }
+    }
 };
 } // namespace vans
 
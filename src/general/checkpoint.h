@@ -0,0 +1,197 @@
+#ifndef VANS_CHECKPOINT_H
+#define VANS_CHECKPOINT_H
+
+#include "common.h"
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vans
+{
+
+/* Checkpoint: binary snapshot of the warmed component tree, see `[checkpoint]` in the config
+ *   header : "VANSCKPT", uint32 version, then the frontend state (clk, trace offset, ...) and one tagged block per
+ *            component in tree order
+ *   The same `io` call saves or restores a field, so a component lists its state once in `serialize`. Each component
+ *   block starts with its instance name, restoring into a different organization fails at the first mismatch.
+ *   Callbacks are not saved: a checkpoint is taken when no request is in flight.
+ */
+class checkpoint
+{
+  public:
+    enum class mode { save, restore };
+
+    /* Bump when the layout of any serialized state changes */
+    enum : uint32_t { version = 2 };
+
+  private:
+    template <typename T, typename = void> struct has_serialize : std::false_type {
+    };
+    template <typename T>
+    struct has_serialize<T, std::void_t<decltype(std::declval<T &>().serialize(std::declval<checkpoint &>()))>>
+        : std::true_type {
+    };
+
+    std::fstream file;
+    mode m;
+    std::string filename;
+
+    void raw(void *data, size_t size)
+    {
+        if (saving())
+            file.write(static_cast<const char *>(data), std::streamsize(size));
+        else
+            file.read(static_cast<char *>(data), std::streamsize(size));
+        if (!file.good())
+            throw std::runtime_error("checkpoint file " + filename + " is truncated or not writable.");
+    }
+
+  public:
+    checkpoint()                   = delete;
+    checkpoint(const checkpoint &) = delete;
+    checkpoint &operator=(const checkpoint &) = delete;
+
+    checkpoint(const std::string &filename, mode m) :
+        file(filename, std::ios::binary | (m == mode::save ? std::ios::out | std::ios::trunc : std::ios::in)),
+        m(m),
+        filename(filename)
+    {
+        if (!file.good())
+            throw std::runtime_error("cannot open checkpoint file: " + filename);
+
+        char magic[8] = {'V', 'A', 'N', 'S', 'C', 'K', 'P', 'T'};
+        char expected[8];
+        std::memcpy(expected, magic, sizeof(magic));
+        raw(magic, sizeof(magic));
+        if (std::memcmp(magic, expected, sizeof(magic)) != 0)
+            throw std::runtime_error(filename + " is not a VANS checkpoint.");
+
+        uint32_t ver = version;
+        io(ver);
+        if (ver != version)
+            throw std::runtime_error("checkpoint " + filename + " has version " + std::to_string(ver)
+                                     + ", expected version " + std::to_string(version));
+    }
+
+    [[nodiscard]] bool saving() const
+    {
+        return m == mode::save;
+    }
+
+    [[nodiscard]] bool restoring() const
+    {
+        return m == mode::restore;
+    }
+
+    /* Types with a `serialize(checkpoint &)` member list their own fields, other types are copied as bytes */
+    template <typename T> void io(T &value)
+    {
+        if constexpr (has_serialize<T>::value) {
+            value.serialize(*this);
+        } else {
+            static_assert(std::is_trivially_copyable_v<T>, "checkpoint::io of a type without an overload");
+            raw(&value, sizeof(T));
+        }
+    }
+
+    void io(std::string &str)
+    {
+        size_t size = str.size();
+        io(size);
+        str.resize(size);
+        raw(str.data(), size);
+    }
+
+    template <typename T> void io(std::vector<T> &vec)
+    {
+        size_t size = vec.size();
+        io(size);
+        vec.resize(size);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            raw(vec.data(), size * sizeof(T));
+        } else {
+            for (auto &v : vec)
+                io(v);
+        }
+    }
+
+    template <typename T> void io(std::deque<T> &deq)
+    {
+        size_t size = deq.size();
+        io(size);
+        deq.resize(size);
+        for (auto &v : deq)
+            io(v);
+    }
+
+    /* For elements without a default constructor, restored elements start as copies of `blank` */
+    template <typename T> void io(std::deque<T> &deq, const T &blank)
+    {
+        size_t size = deq.size();
+        io(size);
+        if (restoring()) {
+            deq.clear();
+            deq.resize(size, blank);
+        }
+        for (auto &v : deq)
+            io(v);
+    }
+
+    template <typename K, typename V> void io(std::map<K, V> &map)
+    {
+        io_map(map);
+    }
+
+    template <typename K, typename V> void io(std::unordered_map<K, V> &map)
+    {
+        io_map(map);
+    }
+
+    template <typename Map> void io_map(Map &map)
+    {
+        size_t size = map.size();
+        io(size);
+        if (saving()) {
+            for (auto &[key, value] : map) {
+                auto k = key;
+                io(k);
+                io(value);
+            }
+        } else {
+            map.clear();
+            for (size_t i = 0; i < size; i++) {
+                typename Map::key_type key;
+                io(key);
+                io(map[key]);
+            }
+        }
+    }
+
+    /* Start the block of `name`, a restore fails if the checkpoint has another block here */
+    void tag(const std::string &name)
+    {
+        auto saved = name;
+        io(saved);
+        if (saved != name)
+            throw std::runtime_error("checkpoint " + filename + " does not match the organization: found [" + saved
+                                     + "] where [" + name + "] is expected.");
+    }
+
+    /* Containers of requests hold callbacks, they must be empty when saved */
+    void expect_idle(bool idle, const std::string &what)
+    {
+        if (saving() && !idle)
+            throw std::runtime_error("Internal error, checkpoint of " + what + " with requests in flight.");
+    }
+};
+
+} // namespace vans
+
+#endif // VANS_CHECKPOINT_H
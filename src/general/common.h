@@ -22,6 +22,9 @@ enum : size_t { cpu_cl_size = 64, cpu_cl_bitshift = 6, /* Log2(CPU_CL_SIZE) -->
 using base_callback_f = std::function<void(logic_addr_t, clk_t)>;
 enum class base_request_type { read, write };
 
+/* Span trace sampling of a request, decided once by the first traced component and copied to the requests it causes */
+enum class trace_sample : uint8_t { undecided, sampled, unsampled };
+
 class base_request
 {
   public:
@@ -30,6 +33,7 @@ class base_request
     clk_t depart      = clk_invalid;
 
     base_request_type type;
+    trace_sample sample = trace_sample::undecided;
 
     base_callback_f callback;
 
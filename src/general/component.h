@@ -3,20 +3,92 @@
 
 #include "common.h"
 #include "config.h"
+#include "epoch_stats.h"
 #include "request_queue.h"
+#include "span_trace.h"
 #include "tick.h"
+#include <array>
 #include <memory>
+#include <set>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace vans
 {
 
+/* Callback of a tracked request, see `component::issue_tracked_request`
+ *   Holds the arrival of the request at every tracked level on its path. All these levels complete the request at the
+ *   same clk, so one callback records every level, and a request copied to the next level carries the levels above.
+ *   Only the first level wraps the callback, the levels below and retries of a refused request do not allocate.
+ */
+struct tracked_callback {
+    struct level {
+        histogram *hist;
+        clk_t arrive;
+        span_tracer *tracer;
+        uint32_t track;
+    };
+    /* Levels below are not tracked */
+    enum : size_t { max_levels = 6 };
+
+    base_callback_f callback;
+    std::array<level, max_levels> levels{};
+    size_t depth = 0;
+    bool is_read = false;
+
+    tracked_callback(base_callback_f callback, bool is_read) : callback(std::move(callback)), is_read(is_read) {}
+
+    /* Track req from `arrive` on at one more level, false if it has no callback or too many levels */
+    static bool push_level(base_request &req, histogram &hist, clk_t arrive, span_tracer *tracer, uint32_t track)
+    {
+        if (!req.callback)
+            return false;
+        auto *tracked = req.callback.target<tracked_callback>();
+        if (tracked == nullptr) {
+            req.callback = tracked_callback(std::move(req.callback), req.type == base_request_type::read);
+            tracked      = req.callback.target<tracked_callback>();
+        }
+        if (tracked->depth == max_levels)
+            return false;
+        tracked->levels[tracked->depth++] = {&hist, arrive, tracer, track};
+        return true;
+    }
+
+    /* Undo `push_level` of a request that was not issued, the wrapper stays for its next try */
+    static void pop_level(base_request &req)
+    {
+        req.callback.target<tracked_callback>()->depth--;
+    }
+
+    void operator()(logic_addr_t addr, clk_t curr_clk) const
+    {
+        for (size_t i = depth; i-- > 0;) {
+            auto &l = levels[i];
+            l.hist->record(curr_clk > l.arrive ? curr_clk - l.arrive : 0);
+            if (l.tracer)
+                l.tracer->span(l.track, is_read ? "read" : "write", addr, l.arrive, curr_clk);
+        }
+        callback(addr, curr_clk);
+    }
+};
+
 class base_component : public tick_able
 {
   public:
     std::vector<std::shared_ptr<base_component>> next;
     std::shared_ptr<dumper> stat_dumper = nullptr;
     size_t id                           = 0;
+    std::string name;
+
+    /* Latency at this component, from issue_request to callback, see `component::issue_tracked_request` */
+    histogram hist_read_latency{"", "read_latency"};
+    histogram hist_write_latency{"", "write_latency"};
+    /* Requests reach a component before its tick, so they arrive at the clk after the last tick */
+    clk_t arrive_clk = 0;
+
+    std::shared_ptr<span_tracer> tracer = nullptr;
+    uint32_t trace_track                = 0;
 
     base_component() = default;
 
@@ -32,6 +104,7 @@ class base_component : public tick_able
 
     void tick(clk_t curr_clk) override
     {
+        arrive_clk = curr_clk + 1;
         tick_current(curr_clk);
         tick_next(curr_clk);
     }
@@ -41,18 +114,66 @@ class base_component : public tick_able
         this->id = new_id;
     }
 
+    /* Name of this component instance in stats and traces, e.g. `imc_0` */
+    [[nodiscard]] std::string instance_name() const
+    {
+        return this->name + "_" + std::to_string(this->id);
+    }
+
+    /* Config section of this component, a memory component (`<owner>.media`) shares the section of its owner */
+    [[nodiscard]] std::string config_section() const
+    {
+        const std::string suffix = ".media";
+        auto section             = this->name;
+        while (section.size() > suffix.size()
+               && section.compare(section.size() - suffix.size(), suffix.size(), suffix) == 0)
+            section.resize(section.size() - suffix.size());
+        return section;
+    }
+
+    void assign_name(const std::string &new_name)
+    {
+        this->name                      = new_name;
+        this->hist_read_latency.domain  = new_name;
+        this->hist_write_latency.domain = new_name;
+    }
+
     virtual void connect_next(const std::shared_ptr<base_component> &nc) = 0;
 
     virtual void connect_dumper(std::shared_ptr<dumper> dumper) = 0;
 
+    /* Unlike dumpers, one tracer is shared by the whole component tree */
+    virtual void connect_tracer(std::shared_ptr<span_tracer> tracer) = 0;
+
+    virtual void register_stats(stats_registry &stats) = 0;
+
+    /* open_trace_dumps: open the binary trace files enabled in `[dump]`, e.g. DRAM commands */
+    virtual void open_trace_dumps(const root_config &cfg) = 0;
+
+    /* serialize: save or restore the state of this component and its children, see `checkpoint` */
+    virtual void serialize(checkpoint &ckpt) = 0;
+
     virtual void print_counters() = 0;
 
     virtual base_response issue_request(base_request &req) = 0;
 
+    /* warm: apply req to buffers, tables and tags without timing, used to fast-forward a trace */
+    virtual void warm(const base_request &req) = 0;
+
+    /* reconfigure: re-read latencies and thresholds of the whole tree from `cfg`, see `controller::reconfigure` */
+    virtual void reconfigure(const root_config &cfg) = 0;
+
+    /* reconfigure_keys: add the `section.key`s `reconfigure` reads in the whole tree to `keys` */
+    virtual void reconfigure_keys(const root_config &cfg, std::set<std::string> &keys) = 0;
+
     virtual bool full() = 0;
 
     virtual bool pending() = 0;
 
+    /* next_event: the first clk from `curr_clk` on with work due in this component or below while no request is
+     *   pending, see `controller::next_event` */
+    virtual clk_t next_event(clk_t curr_clk) = 0;
+
     virtual void drain() = 0;
 };
 
@@ -79,6 +200,10 @@ template <typename MemoryControllerType, typename MemoryType> class component :
     {
         this->stat_dumper          = dumper;
         this->ctrl->counter_dumper = dumper;
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component)
+                this->memory_component->connect_dumper(dumper);
+        }
         if (this->stat_dumper != nullptr && !this->next.empty()) {
             if (this->next.size() == 1) {
                 this->next[0]->connect_dumper(dumper);
@@ -88,16 +213,134 @@ template <typename MemoryControllerType, typename MemoryType> class component :
         }
     }
 
+    /* Issue req to ctrl, recording its latency at this component when the callback runs */
+    base_response issue_tracked_request(base_request &req)
+    {
+        auto &hist   = req.type == base_request_type::read ? this->hist_read_latency : this->hist_write_latency;
+        auto *tracer = (this->tracer && this->tracer->sampled(req.sample, req.addr)) ? this->tracer.get() : nullptr;
+        bool tracked = tracked_callback::push_level(req, hist, this->arrive_clk, tracer, this->trace_track);
+
+        auto res = this->ctrl->issue_request(req);
+        if (tracked && !std::get<0>(res))
+            tracked_callback::pop_level(req);
+        return res;
+    }
+
     bool full() override
     {
         return this->ctrl->full();
     }
 
+    void warm(const base_request &req) override
+    {
+        this->ctrl->warm(req);
+    }
+
+    void reconfigure(const root_config &cfg) override
+    {
+        this->ctrl->reconfigure(cfg[this->config_section()]);
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component) {
+                name_memory_component();
+                this->memory_component->reconfigure(cfg);
+            }
+        }
+        for (auto &next : this->next)
+            next->reconfigure(cfg);
+    }
+
+    void reconfigure_keys(const root_config &cfg, std::set<std::string> &keys) override
+    {
+        auto section = this->config_section();
+        for (auto &key : this->ctrl->reconfigure_keys(cfg[section]))
+            keys.insert(section + "." + key);
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component) {
+                name_memory_component();
+                this->memory_component->reconfigure_keys(cfg, keys);
+            }
+        }
+        for (auto &next : this->next)
+            next->reconfigure_keys(cfg, keys);
+    }
+
+    void connect_tracer(std::shared_ptr<span_tracer> tracer) override
+    {
+        this->tracer            = tracer;
+        this->trace_track       = tracer->add_track(this->instance_name());
+        this->ctrl->tracer      = tracer;
+        this->ctrl->trace_track = this->trace_track;
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component) {
+                name_memory_component();
+                this->memory_component->connect_tracer(tracer);
+            }
+        }
+        for (auto &next : this->next)
+            next->connect_tracer(tracer);
+    }
+
+    void register_stats(stats_registry &stats) override
+    {
+        this->ctrl->register_stats(stats, this->instance_name());
+        stats.add_histogram(this->hist_read_latency);
+        stats.add_histogram(this->hist_write_latency);
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component) {
+                name_memory_component();
+                this->memory_component->register_stats(stats);
+            }
+        }
+        for (auto &next : this->next)
+            next->register_stats(stats);
+    }
+
+    void open_trace_dumps(const root_config &cfg) override
+    {
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component) {
+                name_memory_component();
+                this->memory_component->open_trace_dumps(cfg);
+            }
+        }
+        for (auto &next : this->next)
+            next->open_trace_dumps(cfg);
+    }
+
+    void serialize(checkpoint &ckpt) override
+    {
+        ckpt.tag(this->instance_name());
+        ckpt.io(this->arrive_clk);
+        ckpt.io(this->hist_read_latency);
+        ckpt.io(this->hist_write_latency);
+        this->ctrl->serialize(ckpt);
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component) {
+                name_memory_component();
+                this->memory_component->serialize(ckpt);
+            }
+        }
+        for (auto &next : this->next)
+            next->serialize(ckpt);
+    }
+
     bool pending() override
     {
         return this->ctrl->pending();
     }
 
+    clk_t next_event(clk_t curr_clk) override
+    {
+        clk_t clk = this->ctrl->next_event(curr_clk);
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component)
+                clk = std::min(clk, this->memory_component->next_event(curr_clk));
+        }
+        for (auto &next : this->next)
+            clk = std::min(clk, next->next_event(curr_clk));
+        return clk;
+    }
+
     void drain() override
     {
         this->ctrl->drain();
@@ -109,9 +352,28 @@ template <typename MemoryControllerType, typename MemoryType> class component :
         this->ctrl->next_level_components.push_back(nc);
     }
 
+  private:
+    /* A memory component is named after its owner, e.g. `ait.media` */
+    void name_memory_component()
+    {
+        if (this->memory_component->name.empty())
+            this->memory_component->assign_name(this->name + ".media");
+    }
+
+  public:
     void print_counters() override
     {
         this->ctrl->print_counters();
+        if (this->stat_dumper != nullptr) {
+            if (this->hist_read_latency.count() != 0)
+                this->hist_read_latency.print(this->stat_dumper);
+            if (this->hist_write_latency.count() != 0)
+                this->hist_write_latency.print(this->stat_dumper);
+        }
+        if constexpr (std::is_base_of_v<base_component, MemoryType>) {
+            if (this->memory_component)
+                this->memory_component->print_counters();
+        }
         for (auto &next : this->next) {
             next->print_counters();
         }
@@ -9,6 +9,7 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace vans
 {
@@ -55,6 +56,10 @@ class config : public base_config<std::string>
 {
   public:
     std::string section_name;
+
+    /* When set, `get_string` and `get_ulong` add the keys they read, e.g. to list the keys a parser consumes */
+    mutable std::vector<std::string> *read_log = nullptr;
+
     config() = delete;
 
     explicit config(std::string section_name) : base_config<std::string>(), section_name(std::move(section_name)) {}
@@ -66,6 +71,8 @@ class config : public base_config<std::string>
 
     const std::string &get_string(const std::string &key) const
     {
+        if (read_log != nullptr)
+            read_log->push_back(key);
         try {
             return this->cfg.at(key);
         } catch (std::out_of_range &e) {
@@ -77,6 +84,8 @@ class config : public base_config<std::string>
 
     unsigned long get_ulong(const std::string &key) const
     {
+        if (read_log != nullptr)
+            read_log->push_back(key);
         try {
             return std::stoul(this->cfg.at(key));
         } catch (std::out_of_range &e) {
@@ -140,16 +149,38 @@ class root_config : public base_config<config>
         std::string type;
     };
 
+    /* Organization value: `count * type`, or `count * type + count * type + ...` for heterogeneous children.
+     * A type may name an instance as `type.instance`, which reads its settings from section `[type.instance]`.
+     */
+    std::vector<organization> get_organizations(const std::string &key) const
+    {
+        std::vector<organization> orgs;
+        auto org_str = cfg.at("organization")[key];
+        size_t begin = 0;
+        while (begin <= org_str.size()) {
+            auto end = org_str.find('+', begin);
+            if (end == std::string::npos)
+                end = org_str.size();
+            auto group         = org_str.substr(begin, end - begin);
+            auto delimiter_pos = group.find('*');
+            if (delimiter_pos == std::string::npos) {
+                throw std::runtime_error("Config format error: " + org_str);
+            }
+            auto count = std::stoi(group.substr(0, delimiter_pos));
+            auto level = group.substr(delimiter_pos + 1);
+            orgs.push_back({count, level});
+            begin = end + 1;
+        }
+        return orgs;
+    }
+
     organization get_organization(const std::string &key) const
     {
-        auto org_str       = cfg.at("organization")[key];
-        auto delimiter_pos = org_str.find('*');
-        if (delimiter_pos == std::string::npos) {
-            throw std::runtime_error("Config format error: " + org_str);
+        auto orgs = get_organizations(key);
+        if (orgs.size() != 1) {
+            throw std::runtime_error("Config format error: [" + key + "] has more than one child type");
         }
-        auto count = std::stoi(org_str.substr(0, delimiter_pos));
-        auto level = org_str.substr(delimiter_pos + 1);
-        return {count, level};
+        return orgs[0];
     }
 };
 
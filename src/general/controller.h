@@ -5,6 +5,8 @@
 #include "mapping.h"
 #include "tick.h"
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace vans
 {
@@ -14,6 +16,9 @@ template <typename RequestType, typename ModelType> class controller : public ti
   public:
     std::shared_ptr<ModelType> local_memory_model;
     std::shared_ptr<dumper> counter_dumper;
+    /* Optional span tracer, and the track of the owner component */
+    std::shared_ptr<span_tracer> tracer;
+    uint32_t trace_track = 0;
     std::vector<std::shared_ptr<base_component>> next_level_components;
 
     controller() = default;
@@ -21,6 +26,25 @@ template <typename RequestType, typename ModelType> class controller : public ti
     /* issue_request: issue a new request to this controller */
     [[nodiscard]] virtual base_response issue_request(RequestType &request) = 0;
 
+    /* warm: functional access without timing and counters, `req.arrive` orders the accesses for LRU */
+    virtual void warm(const base_request &req) {}
+
+    /* reconfigure: re-read latencies and thresholds from `cfg`, e.g. for one point of a sweep; sizes stay */
+    virtual void reconfigure(const config &cfg) {}
+
+    /* reconfigure_keys: the keys of `cfg` that `reconfigure` reads, a sweep may only vary these */
+    [[nodiscard]] virtual std::vector<std::string> reconfigure_keys(const config &cfg) const
+    {
+        return {};
+    }
+
+    /* next_event: the first clk from `curr_clk` on with work due besides pending requests, e.g. a refresh or queued
+     *   writes, `clk_invalid` if none; an idle model is not ticked before it, see `gem5_wrapper::next_event_clk` */
+    virtual clk_t next_event(clk_t curr_clk)
+    {
+        return clk_invalid;
+    }
+
     /* drain: drain this controller to finish all on-going requests*/
     bool is_draining     = false;
     virtual void drain() = 0;
@@ -33,28 +57,54 @@ template <typename RequestType, typename ModelType> class controller : public ti
 
     /* print_counters: print all counters to console */
     virtual void print_counters() {}
+
+    /* register_stats: add counters and queue occupancy gauges to the stats registry, e.g. the epoch time series */
+    virtual void register_stats(stats_registry &stats, const std::string &component) {}
+
+    /* serialize: save or restore buffers, tables and counters, queues are empty when no request is in flight */
+    virtual void serialize(checkpoint &ckpt) {}
 };
 
 template <typename... Types> class memory_controller : public controller<Types...>
 {
   public:
+    std::string mapping_func_name;
     component_mapping_f mapping_func;
+    size_t mapping_total_components = 0;
 
     memory_controller() = delete;
 
-    explicit memory_controller(const config &cfg)
+    explicit memory_controller(const config &cfg) : mapping_func_name(cfg["component_mapping_func"])
     {
-        this->mapping_func = get_component_mapping_func(cfg["component_mapping_func"]);
+        /* Validate the mapping function early, it is rebuilt once all next level components are connected */
+        this->mapping_func = get_component_mapping_func(mapping_func_name, 1);
     }
 
     virtual void drain_current() = 0;
 
+    /* Map addr to the address and index of the next level component */
+    std::tuple<addr_t, size_t> get_next_level_index(addr_t addr)
+    {
+        if (this->mapping_total_components != this->next_level_components.size()) {
+            this->mapping_total_components = this->next_level_components.size();
+            this->mapping_func = get_component_mapping_func(mapping_func_name, this->mapping_total_components);
+        }
+        return this->mapping_func(addr);
+    }
+
     virtual std::tuple<addr_t, std::shared_ptr<base_component>> get_next_level(addr_t addr)
     {
-        auto [next_addr, component_index] = this->mapping_func(addr, this->next_level_components.size());
+        auto [next_addr, component_index] = this->get_next_level_index(addr);
         return {next_addr, this->next_level_components[component_index]};
     }
 
+    /* Warm the next level component of `addr` with a request of `type` */
+    void warm_next_level(base_request_type type, addr_t addr, clk_t curr_clk)
+    {
+        auto [next_addr, next] = this->get_next_level(addr);
+        next->warm(base_request(type, next_addr, curr_clk));
+    }
+
     void drain() override
     {
         if (this->is_draining) {
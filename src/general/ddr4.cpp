@@ -11,6 +11,16 @@ DDR4::DDR4(struct timing t) : timing(t), read_latency(t.nCL + t.nBL)
     init_prereq_table();
 }
 
+void DDR4::retime(struct timing t)
+{
+    this->timing       = t;
+    this->read_latency = t.nCL + t.nBL;
+    for (auto &level_table : timing_table)
+        for (auto &entries : level_table)
+            entries.clear();
+    init_timing_table();
+}
+
 void DDR4::init_state_trans_table()
 {
     using s = state;
@@ -333,6 +343,28 @@ bool DDR4::is_refreshing(DDR4::command cmd)
     return cmd == command::REF;
 }
 
+DDR4::command DDR4::to_auto_precharge(DDR4::command cmd)
+{
+    switch (cmd) {
+    case command::RD:
+        return command::RDA;
+    case command::WR:
+        return command::WRA;
+    default:
+        return cmd;
+    }
+}
+
+bool DDR4::is_broadcast(DDR4::command cmd, DDR4::level l)
+{
+    return false;
+}
+
+size_t DDR4::refresh_rotation() const
+{
+    return 1;
+}
+
 void DDR4::print_config()
 {
     std::cout << "size:\t" << size << std::endl;
@@ -235,6 +235,13 @@ class DDR4
     static bool is_closing(command cmd);
     static bool is_accessing(command cmd);
     static bool is_refreshing(command cmd);
+    static command to_auto_precharge(command cmd);
+    static bool is_broadcast(command cmd, level l);
+
+    size_t refresh_rotation() const;
+
+    /* Replace the timing parameters, e.g. for one point of a sweep, the organization stays */
+    void retime(struct timing t);
 
     void print_config();
 
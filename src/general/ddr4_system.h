@@ -3,15 +3,17 @@
 
 #include "component.h"
 #include "controller.h"
+#include "factory.h"
 #include "static_memory.h"
 
 namespace vans::ddr4_system
 {
-class ddr4_system_controller : public memory_controller<vans::base_request, vans::dram::ddr::ddr4_memory>
+/* The local memory model is any DRAM standard, see `factory::make_dram_memory` */
+class ddr4_system_controller : public memory_controller<vans::base_request, base_component>
 {
   public:
     ddr4_system_controller() = delete;
-    explicit ddr4_system_controller(const config &cfg, std::shared_ptr<vans::dram::ddr::ddr4_memory> memory) :
+    explicit ddr4_system_controller(const config &cfg, std::shared_ptr<base_component> memory) :
         memory_controller(cfg)
     {
         this->local_memory_model = std::move(memory);
@@ -43,20 +45,20 @@ class ddr4_system_controller : public memory_controller<vans::base_request, vans
     }
 };
 
-class ddr4_system : public component<ddr4_system_controller, dram::ddr::ddr4_memory>
+class ddr4_system : public component<ddr4_system_controller, base_component>
 {
   public:
     ddr4_system() = delete;
 
     explicit ddr4_system(const config &cfg)
     {
-        this->memory_component = std::make_shared<vans::dram::ddr::ddr4_memory>(cfg);
+        this->memory_component = factory::make_dram_memory(cfg);
         this->ctrl             = std::make_shared<ddr4_system_controller>(cfg, this->memory_component);
     }
 
     base_response issue_request(base_request &req) override
     {
-        return this->ctrl->issue_request(req);
+        return this->issue_tracked_request(req);
     }
 };
 } // namespace vans::ddr4_system
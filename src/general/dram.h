@@ -153,12 +153,18 @@ template <typename T> class DRAM : public tick_able
         if (curr_level == spec->scope[int(cmd)] || !children.size())
             return;
 
-        children[child_id]->update_state(cmd, addr);
+        if (T::is_broadcast(cmd, level(int(curr_level) + 1))) {
+            for (auto c : children)
+                c->update_state(cmd, addr);
+        } else {
+            children[child_id]->update_state(cmd, addr);
+        }
     }
     void update_timing(command cmd, addr_t addr, clk_t clk)
     {
 
-        if (this->id != addr[int(curr_level)]) {
+        /* A broadcast command (e.g. same-bank refresh) targets every node on its broadcast level */
+        if (this->id != addr[int(curr_level)] && !T::is_broadcast(cmd, curr_level)) {
             for (auto &t : timing_table[int(cmd)]) {
                 if (false == t.has_sibling)
                     continue;
@@ -192,6 +198,23 @@ template <typename T> class DRAM : public tick_able
     }
 
     void update_serving_requests(addr_t addr, int delta, clk_t clk) {}
+
+    /* Bank states and timing of this node and its children */
+    void serialize(checkpoint &ckpt)
+    {
+        ckpt.io(curr_state);
+        ckpt.io(row_state);
+        ckpt.io(curr_clk);
+        ckpt.io(next);
+        /* Keep the history depth of the current timing, so a checkpoint can resume with other DRAM timings */
+        for (auto &p : prev) {
+            auto depth = p.size();
+            ckpt.io(p);
+            p.resize(depth, -1);
+        }
+        for (auto child : children)
+            child->serialize(ckpt);
+    }
 };
 
 
@@ -8,6 +8,23 @@
 namespace vans::dram
 {
 
+/* DRAM command trace (`[dump] dram_trace_dump`), one binary file per dram_memory
+ *   header : "VANSDRAM", uint32 record size, uint32 command count, NUL-terminated command names in command order
+ *   records: one `dram_cmd_record` (little-endian) per issued command, ordered by clk
+ */
+#pragma pack(push, 1)
+struct dram_cmd_record {
+    uint64_t clk;
+    uint32_t row;
+    uint16_t col;
+    uint8_t cmd;
+    uint8_t channel;
+    uint8_t rank;
+    uint8_t bank_group;
+    uint8_t bank;
+};
+#pragma pack(pop)
+
 class dram_media_request
 {
   public:
@@ -27,13 +44,20 @@ class dram_media_request
     long arrive = -1;
     long depart = -1;
 
+    trace_sample sample = trace_sample::undecided;
+
     using callback_f = std::function<void(logic_addr_t, clk_t)>;
     callback_f callback;
 
     dram_media_request() = delete;
 
     explicit dram_media_request(base_request &req) :
-        is_first_cmd(true), addr(req.addr), callback(req.callback), arrive(req.arrive), depart(req.depart)
+        is_first_cmd(true),
+        addr(req.addr),
+        callback(req.callback),
+        arrive(req.arrive),
+        depart(req.depart),
+        sample(req.sample)
     {
         if (req.type == base_request_type::read)
             type = req_type::read;
@@ -43,7 +67,7 @@ class dram_media_request
             throw std::runtime_error("Unknown base_request type: " + std::to_string(int(req.type)));
     }
 
-    dram_media_request(mapped_addr_t &mapped_addr, req_type type, int coreid = 0) :
+    dram_media_request(const mapped_addr_t &mapped_addr, req_type type, int coreid = 0) :
         is_first_cmd(true), addr(mapped_addr), coreid(coreid), type(type)
     {
     }
@@ -53,8 +77,8 @@ class dram_media_request
     {
     }
 
-    dram_media_request(addr_type_t addr, req_type type, int coreid = 0) :
-        addr(std::move(addr)), is_first_cmd(true), type(type), coreid(coreid)
+    dram_media_request(const addr_type_t &addr, req_type type, int coreid = 0) :
+        addr(addr), is_first_cmd(true), type(type), coreid(coreid)
     {
     }
     explicit dram_media_request(long addr, req_type type, callback_f callback = nullptr, int coreid = 0) :
@@ -62,6 +86,17 @@ class dram_media_request
     {
     }
 
+    /* The callback is not saved, DRAM never calls back a write, and a checkpoint has no read in flight */
+    void serialize(checkpoint &ckpt)
+    {
+        ckpt.io(is_first_cmd);
+        ckpt.io(addr);
+        ckpt.io(coreid);
+        ckpt.io(type);
+        ckpt.io(arrive);
+        ckpt.io(depart);
+    }
+
     [[maybe_unused]] [[nodiscard]] std::string to_string() const
     {
         char str_buf[128];
@@ -84,8 +119,24 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
     using request  = dram_media_request;
 
     clk_t last_refreshed_clk = 0;
+    size_t next_refresh_bank = 0;
     bool write_prior_mode    = false;
 
+    /* Row buffer management:
+     *   open     : keep the row open after access
+     *   closed   : auto-precharge (RDA/WRA) after every access
+     *   adaptive : auto-precharge unless another queued request hits the same row
+     *   timeout  : keep the row open, precharge it once idle for `page_timeout` clks
+     */
+    enum class page_policy_t { open, closed, adaptive, timeout } page_policy = page_policy_t::open;
+    clk_t page_timeout                                                    = 0;
+
+    struct open_bank_t {
+        mapped_addr_t addr;
+        clk_t last_access_clk = clk_invalid;
+    };
+    std::vector<open_bank_t> open_banks;
+
   public:
     clk_t curr_clk     = 0;
     clk_t report_epoch = 0;
@@ -105,7 +156,12 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
 
     logic_addr_t start_addr;
 
+    vans::counter cnt_events;
+
   public:
+    /* Shared by all channels of a dram_memory, see `dram_cmd_record` */
+    std::shared_ptr<async_writer> cmd_trace = nullptr;
+
     dram_media_controller() = delete;
 
     explicit dram_media_controller(const config &cfg,
@@ -113,18 +169,49 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
                                    const std::shared_ptr<const dram_mapping<StandardType>> &mapper,
                                    logic_addr_t dram_start_addr) :
         channel(channel),
+        id(channel->id),
         start_addr(dram_start_addr),
         report_epoch(cfg.get_ulong("report_epoch")),
         queue_size(cfg.get_ulong("queue_size")),
         act_queue(cfg.get_ulong("queue_size")),
         misc_queue(cfg.get_ulong("queue_size")),
         read_queue(cfg.get_ulong("queue_size")),
-        write_queue(cfg.get_ulong("queue_size"))
+        write_queue(cfg.get_ulong("queue_size")),
+        cnt_events(cfg.section_name,
+                   "dram.ch" + std::to_string(channel->id),
+                   {"row_hit", "row_miss", "row_conflict", "auto_precharge", "timeout_precharge"})
     {
+        auto policy = cfg.check("page_policy") ? cfg.get_string("page_policy") : "open";
+        if (policy == "open") {
+            page_policy = page_policy_t::open;
+        } else if (policy == "closed") {
+            page_policy = page_policy_t::closed;
+        } else if (policy == "adaptive") {
+            page_policy = page_policy_t::adaptive;
+        } else if (policy == "timeout") {
+            page_policy  = page_policy_t::timeout;
+            page_timeout = cfg.get_ulong("page_timeout");
+        } else {
+            throw std::runtime_error("[CONFIG ERROR]: page_policy value [" + policy
+                                     + "] is illegal, should be [open|closed|adaptive|timeout]");
+        }
     }
 
     virtual ~dram_media_controller() = default;
 
+    void reconfigure(const config &cfg) override
+    {
+        if (page_policy == page_policy_t::timeout)
+            page_timeout = cfg.get_ulong("page_timeout");
+    }
+
+    [[nodiscard]] std::vector<std::string> reconfigure_keys(const config &cfg) const override
+    {
+        if (page_policy == page_policy_t::timeout)
+            return {"page_timeout"};
+        return {};
+    }
+
     dram_request_queue &get_queue(req_type type)
     {
         switch (type) {
@@ -193,15 +280,16 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
             }
         }
 
-        auto refresh_interval = channel->spec->timing.nREFI;
+        /* Standards with same-bank refresh split each tREFI into one refresh per bank index */
+        auto refresh_rotation = channel->spec->refresh_rotation();
+        auto refresh_interval = channel->spec->timing.nREFI / refresh_rotation;
         if (curr_clk - last_refreshed_clk >= refresh_interval) {
-            std::vector<uint64_t> addr_vec(channel->spec->total_levels - 1);
-            addr_vec[0] = channel->id;
+            mapped_addr_t addr_vec                  = {0};
+            addr_vec[int(StandardType::level::channel)] = channel->id;
+            addr_vec[int(StandardType::level::bank)]    = next_refresh_bank;
+            next_refresh_bank                       = (next_refresh_bank + 1) % refresh_rotation;
             for (auto rank : channel->children) {
-                addr_vec[1] = rank->id;
-                /* No bank-level refresh */
-                // addr_vec[2] = -1;
-                // addr_vec[3] = -1;
+                addr_vec[int(StandardType::level::rank)] = rank->id;
                 request req(addr_vec, req_type::refresh);
                 auto [res, deterministic, next_clk] = issue_request(req);
                 if (!res) {
@@ -242,14 +330,16 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
         else
             q = &read_queue;
 
-        schedule(q);
+        if (!schedule(q) && page_policy == page_policy_t::timeout)
+            close_idle_banks();
     }
 
     void drain() override {}
 
+    /* Queued reads are pending too, writes are done for the requester once issued to DRAM */
     bool pending() override
     {
-        return !pending_queue.empty();
+        return !pending_queue.empty() || !read_queue.empty() || !no_read(act_queue.queue);
     }
 
     bool full() override
@@ -257,45 +347,202 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
         return read_queue.full() || write_queue.full();
     }
 
+    /* Queued writes and refreshes are not pending for the requester but still need ticks, so do the next refresh
+     * and, with the `timeout` page policy, the precharge of the first idle bank */
+    clk_t next_event(clk_t from_clk) override
+    {
+        if (write_queue.size() != 0 || misc_queue.size() != 0 || act_queue.size() != 0)
+            return from_clk;
+
+        auto refresh_interval = channel->spec->timing.nREFI / channel->spec->refresh_rotation();
+        clk_t clk             = std::max(from_clk, clk_t(last_refreshed_clk + refresh_interval));
+        if (page_policy == page_policy_t::timeout) {
+            for (auto &bank : open_banks) {
+                if (bank.last_access_clk != clk_invalid)
+                    clk = std::min(clk, std::max(from_clk, clk_t(bank.last_access_clk + page_timeout)));
+            }
+        }
+        return clk;
+    }
+
+    void print_counters() override
+    {
+        this->cnt_events.print(this->counter_dumper);
+    }
+
+    void register_stats(stats_registry &stats, const std::string &component) override
+    {
+        stats.add_counter(component, this->cnt_events);
+        auto prefix = component + ".ch" + std::to_string(this->id);
+        stats.add_gauge(prefix + ".read_queue", [this]() { return this->read_queue.size(); });
+        stats.add_gauge(prefix + ".write_queue", [this]() { return this->write_queue.size(); });
+    }
+
+    void serialize(checkpoint &ckpt) override
+    {
+        ckpt.expect_idle(!pending(), "DRAM channel " + std::to_string(this->id));
+
+        request blank(mapped_addr_t{}, req_type::refresh);
+        ckpt.io(act_queue.queue, blank);
+        ckpt.io(misc_queue.queue, blank);
+        ckpt.io(write_queue.queue, blank);
+        ckpt.io(last_refreshed_clk);
+        ckpt.io(next_refresh_bank);
+        ckpt.io(write_prior_mode);
+        ckpt.io(open_banks);
+        ckpt.io(curr_clk);
+        ckpt.io(report_cnt);
+        ckpt.io(cnt_events);
+        channel->serialize(ckpt);
+    }
+
   private:
+    static bool no_read(const std::deque<request> &q)
+    {
+        return std::none_of(q.begin(), q.end(), [](const request &r) { return r.type == req_type::read; });
+    }
+
     command get_first_cmd(request &req)
     {
         command cmd = channel->spec->req_to_cmd.find(req.type)->second;
-        return channel->decode(cmd, req.addr.mapped_addr.data());
+        cmd         = channel->decode(cmd, req.addr.mapped_addr.data());
+        if (channel->spec->is_accessing(cmd) && close_after_access(req))
+            cmd = StandardType::to_auto_precharge(cmd);
+        return cmd;
     }
 
-    bool is_ready(request &req)
+    bool close_after_access(const request &req)
     {
-        command cmd = get_first_cmd(req);
-        return channel->check(cmd, req.addr.mapped_addr.data(), curr_clk);
+        switch (page_policy) {
+        case page_policy_t::closed:
+            return true;
+        case page_policy_t::adaptive:
+            return !has_queued_row_hit(req.addr.mapped_addr, &req);
+        default:
+            return false;
+        }
     }
 
-    void schedule(dram_request_queue *curr_queue)
+    static bool same_row(const mapped_addr_t &a, const mapped_addr_t &b)
     {
-        if (curr_queue->queue.empty())
+        for (size_t l = 0; l <= size_t(level::row); l++) {
+            if (a[l] != b[l])
+                return false;
+        }
+        return true;
+    }
+
+    /* Return true if any queued request other than `self` targets the same row as `addr` */
+    bool has_queued_row_hit(const mapped_addr_t &addr, const request *self = nullptr)
+    {
+        for (auto q : {&act_queue, &read_queue, &write_queue}) {
+            for (auto &r : q->queue) {
+                if (&r != self && same_row(r.addr.mapped_addr, addr))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    bool is_row_open(const mapped_addr_t &addr)
+    {
+        auto node = channel.get();
+        for (size_t l = size_t(level::rank); l <= size_t(level::bank); l++) {
+            node = node->children[addr[l]];
+        }
+        return node->curr_state == state::opened && node->row_state.count(addr[size_t(level::row)]) != 0;
+    }
+
+    size_t bank_index(const mapped_addr_t &addr)
+    {
+        auto count = channel->spec->count;
+        size_t idx = 0;
+        for (size_t l = size_t(level::rank); l <= size_t(level::bank); l++) {
+            idx = idx * count[l] + addr[l];
+        }
+        return idx;
+    }
+
+    void record_open_bank(const mapped_addr_t &addr)
+    {
+        auto idx = bank_index(addr);
+        if (open_banks.size() <= idx)
+            open_banks.resize(idx + 1);
+        open_banks[idx].addr            = addr;
+        open_banks[idx].last_access_clk = curr_clk;
+    }
+
+    /* Precharge one bank that stays idle longer than `page_timeout` */
+    void close_idle_banks()
+    {
+        for (auto &bank : open_banks) {
+            if (bank.last_access_clk == clk_invalid || curr_clk - bank.last_access_clk < page_timeout)
+                continue;
+
+            if (!is_row_open(bank.addr)) {
+                /* Already closed by a conflict or refresh */
+                bank.last_access_clk = clk_invalid;
+                continue;
+            }
+            if (has_queued_row_hit(bank.addr))
+                continue;
+
+            auto addr = bank.addr.data();
+            if (!channel->check(command::PRE, addr, curr_clk))
+                continue;
+
+            issue_cmd(command::PRE, addr);
+            bank.last_access_clk = clk_invalid;
+            cnt_events["timeout_precharge"]++;
             return;
+        }
+    }
+
+    /* Return true if a command is issued */
+    bool schedule(dram_request_queue *curr_queue)
+    {
+        if (curr_queue->queue.empty())
+            return false;
 
         /* Front of queue */
         auto req = curr_queue->queue.begin();
-        if (!is_ready(*req))
-            return;
+        auto cmd = get_first_cmd(*req);
+        if (!channel->check(cmd, req->addr.mapped_addr.data(), curr_clk))
+            return false;
 
         if (req->is_first_cmd) {
             req->is_first_cmd = false;
             if (req->type == req_type::read || req->type == req_type::write) {
                 channel->update_serving_requests(req->addr.mapped_addr.data(), 1, curr_clk);
+                if (channel->spec->is_accessing(cmd))
+                    cnt_events["row_hit"]++;
+                else if (channel->spec->is_opening(cmd))
+                    cnt_events["row_miss"]++;
+                else
+                    cnt_events["row_conflict"]++;
             }
         }
 
-        auto cmd = get_first_cmd(*req);
         issue_cmd(cmd, req->addr.mapped_addr.data());
+        if (this->tracer && (req->type == req_type::read || req->type == req_type::write)
+            && this->tracer->sampled(req->sample, req->addr.logic_addr)) {
+            this->tracer->instant(
+                this->trace_track, channel->spec->command_name.at(cmd), req->addr.logic_addr, curr_clk);
+        }
+
+        if (channel->spec->is_accessing(cmd)) {
+            if (channel->spec->is_closing(cmd))
+                cnt_events["auto_precharge"]++;
+            else if (page_policy == page_policy_t::timeout)
+                record_open_bank(req->addr.mapped_addr);
+        }
 
         if (!(channel->spec->is_accessing(cmd) || channel->spec->is_refreshing(cmd))) {
             if (channel->spec->is_opening(cmd)) {
                 act_queue.queue.push_back(*req);
                 curr_queue->queue.erase(req);
             }
-            return;
+            return true;
         }
 
         if (req->type == req_type::read) {
@@ -307,12 +554,26 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
         }
 
         curr_queue->queue.erase(req);
+        return true;
     }
 
     void issue_cmd(command cmd, addr_t addr_vec, bool print_trace = false)
     {
         channel->update(cmd, addr_vec, curr_clk);
 
+        if (cmd_trace) {
+            using l = typename StandardType::level;
+            dram_cmd_record rec{curr_clk,
+                                uint32_t(addr_vec[int(l::row)]),
+                                uint16_t(addr_vec[int(l::col)]),
+                                uint8_t(cmd),
+                                uint8_t(addr_vec[int(l::channel)]),
+                                uint8_t(addr_vec[int(l::rank)]),
+                                uint8_t(addr_vec[int(l::bank_group)]),
+                                uint8_t(addr_vec[int(l::bank)])};
+            cmd_trace->write(&rec, sizeof(rec));
+        }
+
         if (print_trace) {
             std::cout << channel->spec->command_name.find(cmd)->second << '\t' << curr_clk << '\t';
             for (int i = 0; i < channel->spec->total_levels; i++)
@@ -322,17 +583,26 @@ class dram_media_controller : public media_controller<dram_media_request, DRAM<S
     }
 };
 
+/* dram_memory: one DRAM tree, one `dram_media_controller` (with its own queues and command bus) per channel.
+ *   Incoming requests are mapped once and routed to the controller of their channel. Channels share no state, so
+ *   a stalled channel does not block the others.
+ */
 template <typename StandardType>
 class dram_memory : public memory<dram_media_controller<StandardType>, DRAM<StandardType>>
 {
   public:
+    using controller_t = dram_media_controller<StandardType>;
+
     std::shared_ptr<StandardType> ddr;
     std::shared_ptr<dram_mapping<StandardType>> mapper;
     logic_addr_t max_addr = 0;
 
+    std::vector<std::shared_ptr<DRAM<StandardType>>> channels;
+    std::vector<std::shared_ptr<controller_t>> channel_ctrls;
+
     dram_memory() = delete;
 
-    explicit dram_memory(const config &cfg) : memory<dram_media_controller<StandardType>, DRAM<StandardType>>(cfg)
+    explicit dram_memory(const config &cfg) : memory<controller_t, DRAM<StandardType>>(cfg)
     {
         typename StandardType::timing_type t(cfg);
 
@@ -347,8 +617,7 @@ class dram_memory : public memory<dram_media_controller<StandardType>, DRAM<Stan
         ddr->count[int(l::row)]        = cfg.get_ulong("row");
         ddr->count[int(l::col)]        = cfg.get_ulong("col");
 
-        mapper                 = std::make_shared<dram_mapping<StandardType>>(ddr, cfg);
-        this->memory_component = std::make_shared<DRAM<StandardType>>(ddr, l::channel);
+        mapper = std::make_shared<dram_mapping<StandardType>>(ddr, cfg);
         if (!is_pwr_of_2(ddr->count[0]) || !is_pwr_of_2(ddr->count[1]))
             throw std::runtime_error("Count of channel and rank not supported (not power of 2)");
 
@@ -357,14 +626,21 @@ class dram_memory : public memory<dram_media_controller<StandardType>, DRAM<Stan
             max_addr *= ddr->count[i];
         }
 
-        this->memory_component->id = 0;
-        this->ctrl                 = std::make_shared<dram_media_controller<StandardType>>(
-            cfg, this->memory_component, mapper, cfg.get_ulong("start_addr"));
+        for (size_t i = 0; i < ddr->count[int(l::channel)]; i++) {
+            auto channel = std::make_shared<DRAM<StandardType>>(ddr, l::channel);
+            channel->id  = i;
+            channels.push_back(channel);
+            channel_ctrls.push_back(std::make_shared<controller_t>(cfg, channel, mapper, cfg.get_ulong("start_addr")));
+        }
+
+        this->memory_component = channels[0];
+        this->ctrl             = channel_ctrls[0];
     }
 
     void tick(clk_t curr_clk) final
     {
-        this->ctrl->tick(curr_clk);
+        for (auto &c : channel_ctrls)
+            c->tick(curr_clk);
     }
 
     double clk_ns()
@@ -376,7 +652,111 @@ class dram_memory : public memory<dram_media_controller<StandardType>, DRAM<Stan
     {
         dram_media_request inner_req(req);
         mapper->map(inner_req.addr);
-        return this->ctrl->issue_request(inner_req);
+        return channel_ctrls[inner_req.addr.mapped_addr[int(StandardType::level::channel)]]->issue_request(inner_req);
+    }
+
+    /* Admission is per channel: `issue_request` refuses a request whose channel queue is full, and the other
+     * channels still take requests, so only report full when no channel can */
+    bool full() final
+    {
+        return std::all_of(channel_ctrls.begin(), channel_ctrls.end(), [](auto &c) { return c->full(); });
+    }
+
+    bool pending() final
+    {
+        return std::any_of(channel_ctrls.begin(), channel_ctrls.end(), [](auto &c) { return c->pending(); });
+    }
+
+    clk_t next_event(clk_t curr_clk) final
+    {
+        clk_t clk = clk_invalid;
+        for (auto &c : channel_ctrls)
+            clk = std::min(clk, c->next_event(curr_clk));
+        return clk;
+    }
+
+    void drain() final
+    {
+        for (auto &c : channel_ctrls)
+            c->drain();
+    }
+
+    void connect_dumper(std::shared_ptr<dumper> dumper) final
+    {
+        this->stat_dumper = dumper;
+        for (auto &c : channel_ctrls)
+            c->counter_dumper = dumper;
+    }
+
+    void connect_tracer(std::shared_ptr<span_tracer> tracer) final
+    {
+        this->tracer      = tracer;
+        this->trace_track = tracer->add_track(this->instance_name());
+        for (auto &c : channel_ctrls) {
+            c->tracer      = tracer;
+            c->trace_track = this->trace_track;
+        }
+    }
+
+    void open_trace_dumps(const root_config &cfg) final
+    {
+        if (!dump_enabled(cfg, "dram_trace_dump"))
+            return;
+
+        auto writer = std::make_shared<async_writer>(get_dump_filename(cfg, "dram_trace_dump", this->id, this->name));
+        uint32_t record_size = sizeof(dram_cmd_record);
+        uint32_t cmd_count   = StandardType::total_commands;
+        writer->write("VANSDRAM", 8);
+        writer->write(&record_size, sizeof(record_size));
+        writer->write(&cmd_count, sizeof(cmd_count));
+        for (const auto &cmd : ddr->command_name)
+            writer->write(cmd.second.c_str(), cmd.second.size() + 1);
+
+        for (auto &c : channel_ctrls)
+            c->cmd_trace = writer;
+    }
+
+    /* Timing tables are rebuilt in place, DRAM nodes keep pointing to them */
+    void reconfigure(const root_config &cfg) final
+    {
+        auto &section = cfg[this->config_section()];
+        ddr->retime(typename StandardType::timing_type(section));
+        for (auto &c : channel_ctrls)
+            c->reconfigure(section);
+    }
+
+    /* The timing keys are those the timing parser reads, but the speed grade (`rate`, `freq`, `tCK`) is not used by
+     * the timing tables, the clock stays `[basic] tCK` */
+    void reconfigure_keys(const root_config &cfg, std::set<std::string> &keys) final
+    {
+        auto name = this->config_section();
+        auto read = channel_ctrls[0]->reconfigure_keys(cfg[name]);
+        config section(cfg[name]);
+        section.read_log = &read;
+        typename StandardType::timing_type timing(section);
+        for (auto &key : read) {
+            if (key != "rate" && key != "freq" && key != "tCK")
+                keys.insert(name + "." + key);
+        }
+    }
+
+    void register_stats(stats_registry &stats) final
+    {
+        for (auto &c : channel_ctrls)
+            c->register_stats(stats, this->instance_name());
+    }
+
+    void serialize(checkpoint &ckpt) final
+    {
+        ckpt.tag(this->instance_name());
+        for (auto &c : channel_ctrls)
+            c->serialize(ckpt);
+    }
+
+    void print_counters() final
+    {
+        for (auto &c : channel_ctrls)
+            c->print_counters();
     }
 };
 
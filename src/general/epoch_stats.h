@@ -0,0 +1,168 @@
+#ifndef VANS_EPOCH_STATS_H
+#define VANS_EPOCH_STATS_H
+
+#include "common.h"
+#include "utils.h"
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vans
+{
+
+/* Stats registry: the counters, gauges and latency histograms of a component tree, see `register_stats`
+ *   Registration follows the tree order, so the registries of two trees built from one config line up entry by entry.
+ */
+class stats_registry
+{
+  protected:
+    std::vector<std::string> counter_columns;
+    std::vector<std::string> gauge_columns;
+    std::vector<counter *> counters;
+    std::vector<std::function<size_t()>> gauges;
+    std::vector<histogram *> histograms;
+
+  public:
+    stats_registry()                       = default;
+    stats_registry(const stats_registry &) = delete;
+    stats_registry &operator=(const stats_registry &) = delete;
+
+    virtual ~stats_registry() = default;
+
+    /* Columns are named `<component>.<domain>.<sub_domain>.<counter>` */
+    void add_counter(const std::string &component, counter &cnt)
+    {
+        for (const auto &c : cnt.index)
+            counter_columns.push_back(component + "." + cnt.domain + "." + cnt.sub_domain + "." + c.first);
+        counters.push_back(&cnt);
+    }
+
+    void add_gauge(const std::string &name, std::function<size_t()> gauge)
+    {
+        gauge_columns.push_back(name);
+        gauges.push_back(std::move(gauge));
+    }
+
+    void add_histogram(histogram &hist)
+    {
+        histograms.push_back(&hist);
+    }
+
+    /* Add the counters and histograms of `other`, the registry of another tree with the same organization */
+    void merge(const stats_registry &other)
+    {
+        if (other.counters.size() != counters.size() || other.histograms.size() != histograms.size())
+            throw std::runtime_error("Internal error, merging the stats of different organizations.");
+        for (size_t i = 0; i < counters.size(); i++)
+            counters[i]->merge(*other.counters[i]);
+        for (size_t i = 0; i < histograms.size(); i++)
+            histograms[i]->merge(*other.histograms[i]);
+    }
+};
+
+/* Epoch stats: a CSV time series, one row every `epoch` clks
+ *   Counters report their increase during the epoch, gauges (e.g. queue occupancy) report their value at the end of
+ *   the epoch. Components register their counters and gauges once, an epoch then costs one copy per counter.
+ */
+class epoch_stats : public stats_registry
+{
+  private:
+    /* Counter values at the last dump, and scratch space for the current ones */
+    std::vector<std::vector<size_t>> last;
+    std::vector<std::vector<size_t>> curr;
+
+    std::ofstream file;
+    clk_t epoch;
+    clk_t last_clk      = 0;
+    clk_t last_dump_clk = 0;
+    bool header_written = false;
+
+    void write_header()
+    {
+        file << "clk";
+        for (const auto &c : counter_columns)
+            file << "," << c;
+        for (const auto &c : gauge_columns)
+            file << "," << c;
+        file << "\n";
+        header_written = true;
+    }
+
+    /* Counters registered since the last snapshot start from zero */
+    void track_new_counters()
+    {
+        for (size_t i = last.size(); i < counters.size(); i++) {
+            last.emplace_back(counters[i]->values.size(), 0);
+            curr.emplace_back(counters[i]->values.size(), 0);
+        }
+    }
+
+  public:
+    epoch_stats()                    = delete;
+    epoch_stats(const epoch_stats &) = delete;
+    epoch_stats &operator=(const epoch_stats &) = delete;
+
+    epoch_stats(const std::string &filename, clk_t epoch) : file(filename), epoch(epoch)
+    {
+        if (!file.good())
+            throw std::runtime_error("cannot open epoch stats file: " + filename);
+        if (epoch == 0)
+            throw std::runtime_error("Internal error, epoch_stats with a zero epoch.");
+    }
+
+    ~epoch_stats() override
+    {
+        /* The last, partial epoch */
+        if (last_clk + 1 > last_dump_clk)
+            dump(last_clk + 1);
+    }
+
+    /* Continue the series at `curr_clk` from the current counter values, e.g. after restoring a checkpoint */
+    void restart(clk_t curr_clk)
+    {
+        track_new_counters();
+        for (size_t i = 0; i < counters.size(); i++)
+            std::memcpy(last[i].data(), counters[i]->values.data(), last[i].size() * sizeof(size_t));
+        last_clk      = curr_clk;
+        last_dump_clk = curr_clk;
+    }
+
+    /* The first clk from `curr_clk` on that dumps a row */
+    [[nodiscard]] clk_t next_dump(clk_t curr_clk) const
+    {
+        clk_t clk = (curr_clk + epoch - 1) / epoch * epoch;
+        return clk != 0 ? clk : epoch;
+    }
+
+    void tick(clk_t curr_clk)
+    {
+        last_clk = curr_clk;
+        if (curr_clk != 0 && curr_clk % epoch == 0)
+            dump(curr_clk);
+    }
+
+    void dump(clk_t curr_clk)
+    {
+        if (!header_written)
+            write_header();
+        track_new_counters();
+        file << curr_clk;
+        for (size_t i = 0; i < counters.size(); i++) {
+            std::memcpy(curr[i].data(), counters[i]->values.data(), curr[i].size() * sizeof(size_t));
+            /* Columns follow the name order of `index` */
+            for (const auto &c : counters[i]->index)
+                file << "," << curr[i][c.second] - last[i][c.second];
+            std::swap(last[i], curr[i]);
+        }
+        for (auto &g : gauges)
+            file << "," << g();
+        file << "\n";
+        last_dump_clk = curr_clk;
+    }
+};
+
+} // namespace vans
+
+#endif // VANS_EPOCH_STATS_H
@@ -2,59 +2,119 @@
 
 #include "ait.h"
 #include "component.h"
+#include "ddr4.h"
 #include "ddr4_system.h"
+#include "ddr5.h"
+#include "hbm.h"
 #include "imc.h"
+#include "memory_mode.h"
 #include "nv_media.h"
 #include "nvram_system.h"
 #include "rmc.h"
 #include "rmw.h"
+#include "surrogate.h"
 #include "utils.h"
 
 namespace vans::factory
 {
+std::string component_type(const std::string &name)
+{
+    return name.substr(0, name.find('.'));
+}
+
 std::shared_ptr<base_component>
 make_single_component(const std::string &name, const root_config &cfg, unsigned int component_id)
 {
     std::shared_ptr<base_component> ret;
-    if (name == "rmc") {
-        ret = std::make_shared<rmc::rmc>(cfg["rmc"]);
-    } else if (name == "imc") {
-        ret = std::make_shared<imc::imc>(cfg["imc"]);
-    } else if (name == "ddr4_system") {
-        ret = std::make_shared<ddr4_system::ddr4_system>(cfg["ddr4_system"]);
-    } else if (name == "nvram_system") {
-        ret = std::make_shared<nvram_system::nvram_system>(cfg["nvram_system"]);
-    } else if (name == "rmw") {
-        ret = std::make_shared<rmw::rmw>(cfg["rmw"]);
-    } else if (name == "ait") {
-        ret = std::make_shared<ait::ait>(cfg["ait"]);
-    } else if (name == "nv_media") {
-        ret = std::make_shared<nv_media>(cfg["nv_media"]);
+    /* `type.instance` names a component of `type` configured by section `[type.instance]` */
+    auto type = component_type(name);
+    if (type == "rmc") {
+        ret = std::make_shared<rmc::rmc>(cfg[name]);
+    } else if (type == "imc") {
+        ret = std::make_shared<imc::imc>(cfg[name]);
+    } else if (type == "ddr4_system") {
+        ret = std::make_shared<ddr4_system::ddr4_system>(cfg[name]);
+    } else if (type == "memory_mode") {
+        ret = std::make_shared<memory_mode::memory_mode>(cfg[name]);
+    } else if (type == "nvram_system") {
+        ret = std::make_shared<nvram_system::nvram_system>(cfg[name]);
+    } else if (type == "rmw") {
+        ret = std::make_shared<rmw::rmw>(cfg[name]);
+    } else if (type == "ait") {
+        ret = std::make_shared<ait::ait>(cfg[name]);
+    } else if (type == "surrogate") {
+        ret = std::make_shared<surrogate::surrogate>(cfg[name]);
+    } else if (type == "nv_media") {
+        ret = std::make_shared<nv_media>(cfg[name]);
+    } else {
+        throw std::runtime_error("Unknown component type [" + type + "] of [" + name + "]");
     }
     ret->assign_id(component_id);
+    ret->assign_name(name);
     return ret;
 }
 std::shared_ptr<base_component>
 make_component(const std::string &name, const root_config &cfg, unsigned int component_id)
 {
-    auto ret = make_single_component(name, cfg, component_id);
-    auto org = cfg.get_organization(name);
-    if (org.count != 0) {
+    auto ret  = make_single_component(name, cfg, component_id);
+    auto type = component_type(name);
+    bool has_next = false;
+    for (auto &org : cfg.get_organizations(name)) {
         for (auto i = 0; i < org.count; i++) {
             auto next = make_component(org.type, cfg, i);
             ret->connect_next(next);
-        }
-        if (name == "nvram_system") {
-            auto dumper = std::make_shared<vans::dumper>(
-                get_dump_type(cfg), get_dump_filename(cfg, "stat_dump", component_id), cfg["dump"]["path"]);
-            ret->connect_dumper(dumper);
+            has_next = true;
         }
     }
+    if (has_next && type == "nvram_system") {
+        auto dumper = std::make_shared<vans::dumper>(get_dump_type(cfg),
+                                                     get_dump_filename(cfg, "stat_dump", component_id,
+                                                                       name == type ? "" : name),
+                                                     cfg["dump"]["path"]);
+        ret->connect_dumper(dumper);
+    }
+    if (type == "imc" || type == "ddr4_system" || type == "memory_mode" || type == "surrogate") {
+        auto dumper = std::make_shared<vans::dumper>(get_dump_type(cfg),
+                                                     get_dump_filename(cfg, "stat_dump", component_id, name),
+                                                     cfg["dump"]["path"]);
+        ret->connect_dumper(dumper);
+    }
     return ret;
 }
 std::shared_ptr<base_component> make(const root_config &cfg)
 {
     /* Return a single virtual root memory controller */
-    return make_component("rmc", cfg);
+    auto root = make_component("rmc", cfg);
+    root->open_trace_dumps(cfg);
+
+    auto &dump_cfg = cfg["dump"];
+    if (dump_cfg.check("span_trace") && dump_cfg["span_trace"] != "none") {
+        auto tracer = std::make_shared<span_tracer>(
+            dump_cfg["path"] + "/" + dump_cfg["span_trace"],
+            std::stod(cfg["basic"]["tCK"]),
+            dump_cfg.check("span_trace_sample_pages") ? dump_cfg.get_ulong("span_trace_sample_pages") : 64,
+            dump_cfg.check("span_trace_max_events") ? dump_cfg.get_ulong("span_trace_max_events") : 1048576);
+        root->connect_tracer(tracer);
+    }
+
+    auto stats_epoch = dump_cfg.check("stats_epoch") ? dump_cfg.get_ulong("stats_epoch") : 0;
+    if (stats_epoch != 0) {
+        auto epoch = std::make_shared<epoch_stats>(dump_cfg["path"] + "/" + dump_cfg["stats_epoch_dump"], stats_epoch);
+        root->register_stats(*epoch);
+        std::static_pointer_cast<rmc::rmc>(root)->epoch = epoch;
+    }
+    return root;
+}
+std::shared_ptr<base_component> make_dram_memory(const config &cfg)
+{
+    std::string standard = cfg.check("standard") ? cfg.get_string("standard") : "DDR4";
+    if (standard == "DDR4") {
+        return std::make_shared<dram::ddr::ddr4_memory>(cfg);
+    } else if (standard == "DDR5") {
+        return std::make_shared<dram::ddr5::ddr5_memory>(cfg);
+    } else if (standard == "HBM") {
+        return std::make_shared<dram::hbm::hbm_memory>(cfg);
+    }
+    throw std::runtime_error("Unknown DRAM standard [" + standard + "] in section [" + cfg.section_name + "]");
 }
 } // namespace vans::factory
@@ -7,6 +7,9 @@
 namespace vans::factory
 {
 
+/* Component type of a component name, e.g. `imc` for both `imc` and `imc.pmem` */
+std::string component_type(const std::string &name);
+
 std::shared_ptr<base_component>
 make_single_component(const std::string &name, const root_config &cfg, unsigned component_id);
 
@@ -16,6 +19,9 @@ make_component(const std::string &name, const root_config &cfg, unsigned compone
 
 std::shared_ptr<base_component> make(const root_config &cfg);
 
+/* Make the DRAM memory model of the standard selected by `standard` (DDR4 by default) */
+std::shared_ptr<base_component> make_dram_memory(const config &cfg);
+
 } // namespace vans::factory
 
 #endif // VANS_FACTORY_H
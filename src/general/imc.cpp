@@ -5,13 +5,48 @@ namespace vans::imc
 
 base_response imc_controller::issue_request(base_request &request)
 {
+    addr_t line = request.addr >> cpu_cl_bitshift;
+
+    if (wpq_lines.count(line)) {
+        if (request.type == base_request_type::read) {
+            /* Read-after-write: the latest data is in wpq */
+            forwarded_reads.push_back(request);
+            cnt_events["read_access"]++;
+            cnt_events["read_forward"]++;
+        } else {
+            /* Merge into the queued write, it completes on acceptance like any write */
+            if (request.callback)
+                request.callback(request.addr, imc_curr_clk);
+            cnt_events["write_access"]++;
+            cnt_events["write_coalesce"]++;
+        }
+        return {true, false, clk_invalid};
+    }
+
+    /* Refuse before copying the request, a frontend retries every clk while the queue is full */
+    if ((request.type == base_request_type::read ? rpq : wpq).full())
+        return {false, false, clk_invalid};
+
+    auto [next_addr, target] = this->get_next_level_index(request.addr);
+    imc_request entry{request, next_addr};
+
     bool success = false;
     switch (request.type) {
     case base_request_type::read:
-        success = rpq.enqueue(request);
+        success = rpq.enqueue(entry, target);
+        if (success)
+            cnt_events["read_access"]++;
         break;
     case base_request_type::write:
-        success = wpq.enqueue(request);
+        /* A write completes once it is in the wpq, the ADR persistence domain, so it does not call back on issue */
+        entry.req.callback = nullptr;
+        success            = wpq.enqueue(entry, target);
+        if (success) {
+            wpq_lines.insert(line);
+            cnt_events["write_access"]++;
+            if (request.callback)
+                request.callback(request.addr, imc_curr_clk);
+        }
         break;
     }
 
@@ -21,54 +56,81 @@ base_response imc_controller::issue_request(base_request &request)
 void imc_controller::tick(clk_t curr_clk)
 {
     this->imc_curr_clk = curr_clk;
+    this->target_blocked.assign(this->next_level_components.size(), false);
+
+    while (!forwarded_reads.empty()) {
+        auto &req = forwarded_reads.front();
+        if (req.callback)
+            req.callback(req.addr, curr_clk);
+        forwarded_reads.pop_front();
+    }
 
     /* Tick wpq and rpq in imc:
-     *   issues write request from wpq
-     *   issues read request from rpq
+     *   issues up to `issue_width` reads, first come first serve among targets that are not blocked
+     *   a read waits while its target has a write in wpq
+     *   when wpq is full, drains the writes of every target, as many as the target accepts
+     *   The configs are calibrated with this order: before the frontends stamped `arrive`, every request tied and the
+     *   first come first serve compare of the original single wpq/rpq always picked the write.
      */
-    enum { none = 0, read, write } queue_to_tick;
-
-    bool rpq_empty = rpq.empty();
-    bool wpq_empty = wpq.empty();
-
-    if (rpq_empty && wpq_empty) {
-        queue_to_tick = none;
-    } else if (rpq_empty) {
-        queue_to_tick = write;
-    } else if (wpq_empty) {
-        queue_to_tick = read;
-    } else {
-        /* First come first serve */
-        if (rpq.queue.front().arrive < wpq.queue.front().arrive) {
-            queue_to_tick = read;
-        } else {
-            queue_to_tick = write;
-        }
-    }
+    bool drain_writes = wpq.full();
 
-    if (queue_to_tick == read) {
-        auto &req              = rpq.queue.front();
-        auto [next_addr, next] = this->get_next_level(req.addr);
-        req.addr               = next_addr;
-        if (!next->full()) {
-            auto [issued, deterministic, next_clk] = next->issue_request(req);
-            if (issued) {
-                rpq.queue.pop_front();
-            }
-        }
-    } else if (queue_to_tick == write) {
-        if (wpq.full()) {
-            flush_wpq();
+    for (size_t issued = 0; issued < this->issue_width;) {
+        size_t rt = no_target;
+        for (size_t t = 0; t < rpq.queues.size(); t++) {
+            if (rpq.queues[t].empty() || this->target_blocked[t] || writes_queued(t))
+                continue;
+            if (rt == no_target || rpq.queues[t].front().req.arrive < rpq.queues[rt].front().req.arrive)
+                rt = t;
         }
-    } else {
-        /* No queue to tick */
+        if (rt == no_target)
+            break;
+        if (issue_head(rpq, rt))
+            issued++;
     }
 
+    if (drain_writes)
+        flush_wpq();
+
     if (!wpq.empty()) {
         adr();
     }
 }
 
+bool imc_controller::writes_queued(size_t target) const
+{
+    return target < wpq.queues.size() && !wpq.queues[target].empty();
+}
+
+void imc_controller::drain_target(size_t target)
+{
+    while (writes_queued(target) && !this->target_blocked[target])
+        issue_head(wpq, target);
+}
+
+bool imc_controller::issue_head(virtual_request_queue<imc_request> &q, size_t target)
+{
+    auto &next = this->next_level_components[target];
+    if (next->full()) {
+        this->target_blocked[target] = true;
+        return false;
+    }
+
+    auto &entry = q.queues[target].front();
+    auto req    = entry.req;
+    req.addr    = entry.next_addr;
+
+    auto [issued, deterministic, next_clk] = next->issue_request(req);
+    if (!issued) {
+        this->target_blocked[target] = true;
+        return false;
+    }
+
+    if (entry.req.type == base_request_type::write)
+        wpq_lines.erase(entry.req.addr >> cpu_cl_bitshift);
+    q.pop_front(target);
+    return true;
+}
+
 void imc_controller::adr()
 {
     if (this->adr_epoch != 0) {
@@ -80,28 +142,9 @@ void imc_controller::adr()
 
 void imc_controller::flush_wpq()
 {
-    while (!wpq.empty()) {
-        auto &req = wpq.queue.front();
-
-        if (!rpq.empty()) {
-            if (rpq.queue.front().arrive < req.arrive) {
-                break;
-            }
-        }
-
-        auto [_, next] = this->get_next_level(req.addr);
-        if (next->full()) {
-            break;
-        }
-
-        auto [issued, deterministic, next_clk] = next->issue_request(req);
-        if (issued) {
-            if (req.callback) {
-                req.callback(req.addr, imc_curr_clk);
-            }
-            wpq.queue.pop_front();
-        }
-    }
+    /* Flush every write, skipping blocked targets */
+    for (size_t t = 0; t < wpq.queues.size(); t++)
+        drain_target(t);
 }
 
 } // namespace vans::imc
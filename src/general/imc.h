@@ -5,18 +5,46 @@
 #include "request_queue.h"
 #include "static_memory.h"
 #include "common.h"
+#include <unordered_set>
 
 namespace vans::imc
 {
 
+/* Request waiting in wpq/rpq, mapped to its target DIMM once on arrival */
+struct imc_request {
+    base_request req;
+    addr_t next_addr;
+};
+
 class imc_controller : public memory_controller<vans::base_request, vans::static_memory>
 {
   public:
-    base_request_queue wpq;
-    base_request_queue rpq;
+    /* Per-target-DIMM virtual queues behind the shared wpq/rpq capacity */
+    virtual_request_queue<imc_request> wpq;
+    virtual_request_queue<imc_request> rpq;
 
     clk_t imc_curr_clk = 0;
     clk_t adr_epoch    = 0;
+    /* Max requests issued to DIMMs per cycle */
+    size_t issue_width = 1;
+    /* Targets that refused a request in the current cycle */
+    std::vector<bool> target_blocked;
+
+    /* Cache lines with a write in wpq, for write coalescing and read-after-write forwarding */
+    std::unordered_set<addr_t> wpq_lines;
+    /* Reads served by wpq, their callbacks are invoked on the next tick */
+    std::deque<base_request> forwarded_reads;
+
+    vans::counter cnt_events{"imc",
+                             "events",
+                             {
+                                 "read_access",
+                                 "write_access",
+                                 "write_coalesce",
+                                 "read_forward",
+                             }};
+
+    enum : size_t { no_target = size_t(-1) };
 
     imc_controller() = delete;
 
@@ -26,15 +54,39 @@ class imc_controller : public memory_controller<vans::base_request, vans::static
         rpq(cfg.get_ulong(("rpq_entries"))),
         adr_epoch(cfg.get_ulong("adr_epoch"))
     {
+        if (cfg.check("issue_width"))
+            this->issue_width = cfg.get_ulong("issue_width");
+        if (this->issue_width == 0)
+            throw std::runtime_error("imc issue_width must be positive.");
     }
 
     base_response issue_request(base_request &request) final;
 
+    void reconfigure(const vans::config &cfg) final
+    {
+        this->adr_epoch = cfg.get_ulong("adr_epoch");
+        if (cfg.check("issue_width"))
+            this->issue_width = cfg.get_ulong("issue_width");
+        if (this->issue_width == 0)
+            throw std::runtime_error("imc issue_width must be positive.");
+    }
+
+    [[nodiscard]] std::vector<std::string> reconfigure_keys(const vans::config &cfg) const final
+    {
+        return {"adr_epoch", "issue_width"};
+    }
+
+    /* Writes persist once in the wpq, so a warmed request goes straight to its DIMM */
+    void warm(const base_request &request) final
+    {
+        this->warm_next_level(request.type, request.addr, request.arrive);
+    }
+
     void drain_current() final{};
 
     bool pending_current() final
     {
-        return wpq.pending() || rpq.pending();
+        return wpq.pending() || rpq.pending() || !forwarded_reads.empty();
     }
 
     void flush_wpq();
@@ -50,6 +102,31 @@ class imc_controller : public memory_controller<vans::base_request, vans::static
     }
 
     void tick(clk_t curr_clk) final;
+
+    void print_counters() final
+    {
+        this->cnt_events.print(this->counter_dumper);
+    }
+
+    void register_stats(stats_registry &stats, const std::string &component) final
+    {
+        stats.add_counter(component, this->cnt_events);
+        stats.add_gauge(component + ".rpq", [this]() { return this->rpq.size(); });
+        stats.add_gauge(component + ".wpq", [this]() { return this->wpq.size(); });
+    }
+
+    void serialize(checkpoint &ckpt) final
+    {
+        ckpt.expect_idle(wpq.empty() && rpq.empty() && forwarded_reads.empty(), "imc");
+        ckpt.io(imc_curr_clk);
+        ckpt.io(cnt_events);
+    }
+
+  private:
+    bool writes_queued(size_t target) const;
+    /* Issue the writes of `target` until the target refuses one */
+    void drain_target(size_t target);
+    bool issue_head(virtual_request_queue<imc_request> &q, size_t target);
 };
 
 class imc : public component<imc_controller, static_memory>
@@ -64,7 +141,14 @@ class imc : public component<imc_controller, static_memory>
 
     base_response issue_request(base_request &req) override
     {
-        return this->ctrl->issue_request(req);
+        return this->issue_tracked_request(req);
+    }
+
+    /* The imc has its own stats file, do not forward the dumper to the next level components */
+    void connect_dumper(std::shared_ptr<dumper> dumper) override
+    {
+        this->stat_dumper          = dumper;
+        this->ctrl->counter_dumper = dumper;
     }
 };
 } // namespace vans::imc
@@ -2,7 +2,12 @@
 #define VANS_MAPPING_H
 
 #include "utils.h"
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <vector>
 
 namespace vans
 {
@@ -10,32 +15,247 @@ namespace vans
 /* Map an address to a tuple of:
  *   1. address inside the component
  *   2. index of the component
+ * The mapping is built once the number of next level components is known, so all divisors are constants.
  */
-using component_mapping_f = std::function<std::tuple<addr_t, size_t>(addr_t, size_t)>;
+using component_mapping_f = std::function<std::tuple<addr_t, size_t>(addr_t)>;
 
-static auto none_mapping = [](addr_t in_addr, size_t total_components) constexpr -> std::tuple<addr_t, size_t>
+/* Divide by a constant without a hardware divide
+ *   Power of 2 divisors use shift/mask, others multiply by a precomputed reciprocal `floor((2^64 - 1) / d)`.
+ *   The reciprocal underestimates the quotient by at most 2, which the correction loop fixes.
+ */
+class const_divider
 {
-    return {in_addr, 0};
-};
+  private:
+    uint64_t divisor  = 1;
+    uint64_t recip    = 0;
+    uint64_t mask     = 0;
+    size_t shift      = 0;
+    bool is_pwr_of_2_ = true;
+
+  public:
+    const_divider() = default;
+    explicit const_divider(uint64_t divisor) : divisor(divisor), is_pwr_of_2_(is_pwr_of_2(divisor))
+    {
+        if (divisor == 0)
+            throw std::runtime_error("Internal error, const_divider divides by zero.");
+        if (is_pwr_of_2_) {
+            shift = log2(divisor);
+            mask  = divisor - 1;
+        } else {
+            recip = std::numeric_limits<uint64_t>::max() / divisor;
+        }
+    }
 
-static auto stride_mapping_4096 = [](addr_t in_addr, size_t total_components) -> std::tuple<addr_t, size_t> {
-    addr_t next_addr         = (((in_addr >> 12U) / total_components) << 12U) | (in_addr & 0xfff);
-    size_t next_component_id = (in_addr >> 12U) % total_components;
-    return {next_addr, next_component_id};
+    [[nodiscard]] uint64_t value() const
+    {
+        return divisor;
+    }
+
+    /* Return quotient, and store remainder to `rem` */
+    uint64_t divide(uint64_t n, uint64_t &rem) const
+    {
+        if (is_pwr_of_2_) {
+            rem = n & mask;
+            return n >> shift;
+        }
+        auto q = uint64_t((unsigned __int128)n * recip >> 64U);
+        rem    = n - q * divisor;
+        while (rem >= divisor) {
+            q++;
+            rem -= divisor;
+        }
+        return q;
+    }
 };
 
-static component_mapping_f get_component_mapping_func(const std::string &mapping_func_name)
+static component_mapping_f none_mapping()
+{
+    return [](addr_t in_addr) -> std::tuple<addr_t, size_t> { return {in_addr, 0}; };
+}
+
+/* Interleave every `granularity` bytes across all components */
+static component_mapping_f stride_mapping(uint64_t granularity, size_t total_components)
+{
+    const_divider gran(granularity);
+    const_divider comp(total_components);
+    return [gran, comp](addr_t in_addr) -> std::tuple<addr_t, size_t> {
+        uint64_t offset, component_id;
+        uint64_t block = gran.divide(in_addr, offset);
+        uint64_t row   = comp.divide(block, component_id);
+        return {row * gran.value() + offset, component_id};
+    };
+}
+
+/* Concatenate components, each component holds `component_size` bytes */
+static component_mapping_f linear_mapping(uint64_t component_size, size_t total_components)
+{
+    const_divider comp_size(component_size);
+    return [comp_size, total_components](addr_t in_addr) -> std::tuple<addr_t, size_t> {
+        uint64_t offset;
+        uint64_t component_id = comp_size.divide(in_addr, offset);
+        if (component_id >= total_components)
+            throw std::runtime_error("Address " + std::to_string(in_addr) + " exceeds linear_mapping range.");
+        return {offset, component_id};
+    };
+}
+
+/* Split `str` by `delimiter`, ignoring delimiters inside parentheses */
+static std::vector<std::string> split_mapping_args(const std::string &str, char delimiter)
+{
+    std::vector<std::string> ret;
+    std::string curr;
+    int depth = 0;
+    for (auto c : str) {
+        if (c == '(')
+            depth++;
+        else if (c == ')')
+            depth--;
+        if (c == delimiter && depth == 0) {
+            ret.push_back(curr);
+            curr.clear();
+        } else {
+            curr += c;
+        }
+    }
+    ret.push_back(curr);
+    return ret;
+}
+
+/* Parse `name(arg)` into name and arg, arg is empty if there's no parentheses */
+static std::tuple<std::string, std::string> parse_mapping_func(const std::string &func)
+{
+    auto lpar = func.find('(');
+    if (lpar == std::string::npos)
+        return {func, ""};
+    if (func.back() != ')')
+        throw std::runtime_error("Unknown component mapping function: " + func);
+    return {func.substr(0, lpar), func.substr(lpar + 1, func.size() - lpar - 2)};
+}
+
+static component_mapping_f get_component_mapping_func(const std::string &mapping_func_name, size_t total_components);
+
+/* Address ranges with their own mapping, e.g. an interleaved region followed by a non-interleaved region:
+ *   range_mapping(6442450944*stride_mapping(4096),6442450944*linear_mapping)
+ * Each region of `size` bytes takes `size / total_components` bytes from every component, regions are stacked in
+ * component address space in the same order. `linear_mapping` without argument fills one component after another.
+ */
+static component_mapping_f range_mapping(const std::string &regions_str, size_t total_components)
+{
+    struct region {
+        addr_t start;
+        addr_t end;
+        addr_t component_base;
+        component_mapping_f mapping;
+    };
+    std::vector<region> regions;
+
+    addr_t start = 0;
+    for (const auto &region_str : split_mapping_args(regions_str, ',')) {
+        auto delimiter_pos = region_str.find('*');
+        if (delimiter_pos == std::string::npos)
+            throw std::runtime_error("range_mapping region format error: " + region_str);
+        uint64_t size     = std::stoul(region_str.substr(0, delimiter_pos));
+        auto mapping_name = region_str.substr(delimiter_pos + 1);
+        if (size == 0 || size % total_components != 0)
+            throw std::runtime_error("range_mapping region size is not a multiple of component count: " + region_str);
+
+        if (mapping_name == "linear_mapping")
+            mapping_name += "(" + std::to_string(size / total_components) + ")";
+        regions.push_back({start, start + size, start / total_components,
+                           get_component_mapping_func(mapping_name, total_components)});
+        start += size;
+    }
+
+    return [regions](addr_t in_addr) -> std::tuple<addr_t, size_t> {
+        auto r = std::upper_bound(
+            regions.begin(), regions.end(), in_addr, [](addr_t addr, const region &r) { return addr < r.end; });
+        if (r == regions.end())
+            throw std::runtime_error("Address " + std::to_string(in_addr) + " exceeds range_mapping regions.");
+        auto [next_addr, component_id] = r->mapping(in_addr - r->start);
+        return {r->component_base + next_addr, component_id};
+    };
+}
+
+/* Physical address ranges routed to explicit components, e.g. DRAM below 4 GiB and NVRAM above it:
+ *   address_map(4294967296*0,17179869184*1)
+ * Ranges are laid out back to back from address 0, each `size*index` range goes to component `index` (in the order
+ * of the `[organization]` entry). A component serving several ranges sees them concatenated in its address space.
+ * Lookup is a binary search over the range ends.
+ */
+static component_mapping_f address_map(const std::string &ranges_str, size_t total_components)
 {
-    if (mapping_func_name == "none_mapping") {
-        return none_mapping;
-    } else if (mapping_func_name == "stride_mapping(4096)") {
-        return stride_mapping_4096;
+    struct range {
+        addr_t start;
+        addr_t end;
+        addr_t component_base;
+        size_t component_id;
+    };
+    std::vector<range> ranges;
+    std::vector<addr_t> component_used;
+
+    addr_t start = 0;
+    for (const auto &range_str : split_mapping_args(ranges_str, ',')) {
+        auto delimiter_pos = range_str.find('*');
+        if (delimiter_pos == std::string::npos)
+            throw std::runtime_error("address_map range format error: " + range_str);
+        uint64_t size       = std::stoul(range_str.substr(0, delimiter_pos));
+        size_t component_id = std::stoul(range_str.substr(delimiter_pos + 1));
+        if (size == 0)
+            throw std::runtime_error("address_map range size is zero: " + range_str);
+        if (component_id >= component_used.size())
+            component_used.resize(component_id + 1, 0);
+
+        ranges.push_back({start, start + size, component_used[component_id], component_id});
+        component_used[component_id] += size;
+        start += size;
+    }
+
+    /* The mapping is first built before next level components are connected, so component ids are checked here */
+    return [ranges, total_components](addr_t in_addr) -> std::tuple<addr_t, size_t> {
+        auto r = std::upper_bound(
+            ranges.begin(), ranges.end(), in_addr, [](addr_t addr, const range &r) { return addr < r.end; });
+        if (r == ranges.end())
+            throw std::runtime_error("Address " + std::to_string(in_addr) + " exceeds address_map ranges.");
+        if (r->component_id >= total_components)
+            throw std::runtime_error("address_map range targets missing component " + std::to_string(r->component_id));
+        return {r->component_base + (in_addr - r->start), r->component_id};
+    };
+}
+
+static component_mapping_f get_component_mapping_func(const std::string &mapping_func_name, size_t total_components)
+{
+    auto [name, arg] = parse_mapping_func(mapping_func_name);
+    if (total_components == 0)
+        total_components = 1;
+
+    if (name == "none_mapping") {
+        return none_mapping();
+    } else if (name == "stride_mapping" && !arg.empty()) {
+        return stride_mapping(std::stoul(arg), total_components);
+    } else if (name == "linear_mapping" && !arg.empty()) {
+        return linear_mapping(std::stoul(arg), total_components);
+    } else if (name == "range_mapping" && !arg.empty()) {
+        return range_mapping(arg, total_components);
+    } else if (name == "address_map" && !arg.empty()) {
+        return address_map(arg, total_components);
     } else {
-        throw std::runtime_error("Unknown dram_mapping function: " + mapping_func_name);
+        throw std::runtime_error("Unknown component mapping function: " + mapping_func_name);
     }
 }
 
-/* Map address for DRAM media */
+/* Map address for DRAM media
+ *   The `media_mapping_func` string (e.g. `RaBaBgRoCoCh`) lists the levels from the most significant bits to the
+ *   least significant bits. It is compiled at construction into a per-level (shift, mask) pair, so mapping an
+ *   address is one shift and one mask per level, without any per-request allocation or decoding.
+ *
+ *   The optional `media_mapping_hash` then XORs row bits into the channel/rank/bank_group/bank indices:
+ *     none        : pure bit-slice mapping (default)
+ *     permutation : permutation-based interleaving, the lowest row bits are XORed into bank, then bank_group,
+ *                   then rank and channel
+ *     xor         : each level is XORed with the row bits selected by `xor_mask_<level>` (decimal row-bit mask,
+ *                   missing key means no hashing on that level), folded into the width of that level
+ *   Each hash is a bijection inside a row, so no two addresses alias.
+ */
 template <typename StandardType> class dram_mapping
 {
   private:
@@ -53,8 +273,15 @@ template <typename StandardType> class dram_mapping
     size_t prefetch_size;
 
     size_t tx_bit_width = 0;
-    std::vector<size_t> addr_bit_width;
-    uint64_t code = 0;
+    std::array<size_t, dram::max_levels> addr_bit_width{0};
+    std::array<size_t, dram::max_levels> level_shift{0};
+    std::array<uint64_t, dram::max_levels> level_mask{0};
+
+    bool hashed = false;
+    std::array<uint64_t, dram::max_levels> xor_mask{0};
+
+    static_assert(StandardType::total_levels <= dram::max_levels,
+                  "StandardType::total_levels exceeds dram::max_levels, enlarge dram::max_levels.");
 
   public:
     dram_mapping()                     = delete;
@@ -62,8 +289,7 @@ template <typename StandardType> class dram_mapping
     explicit dram_mapping(const std::shared_ptr<StandardType> spec, const config &cfg) :
         total_levels(StandardType::total_levels),
         channel_width(spec->channel_width),
-        prefetch_size(spec->prefetch_size),
-        addr_bit_width(StandardType::total_levels)
+        prefetch_size(spec->prefetch_size)
     {
 #define LOAD_FROM_CONFIG(key) this->key = cfg.get_ulong(#key);
         LOAD_FROM_CONFIG(size)
@@ -87,37 +313,37 @@ template <typename StandardType> class dram_mapping
         }
         addr_bit_width[total_levels - 1] -= log2(prefetch_size);
 
-        // encode
+        /* Decode the mapping string, from the most significant level to the least significant level */
         std::string mapping_func = cfg["media_mapping_func"];
-        for (unsigned i = 0; i < total_levels; i++) {
-            std::string this_level = mapping_func.substr(i * 2, 2);
-            uint64_t level_num     = 0;
-            if (this_level == "Ch")
-                level_num = 0;
-            else if (this_level == "Ra")
-                level_num = 1;
-            else if (this_level == "Bg")
-                level_num = 2;
-            else if (this_level == "Ba")
-                level_num = 3;
-            else if (this_level == "Ro")
-                level_num = 4;
-            else if (this_level == "Co")
-                level_num = 5;
-            this->code |= (level_num & 0xfU) << (i * 4);
+        if (mapping_func.size() != total_levels * 2)
+            throw std::runtime_error("Unknown dram_mapping function: " + mapping_func);
+
+        size_t shift = tx_bit_width;
+        for (int i = int(total_levels) - 1; i >= 0; --i) {
+            auto level_id = level_index(mapping_func.substr(i * 2, 2));
+            if (level_id == size_invalid)
+                throw std::runtime_error("Unknown dram_mapping level in function: " + mapping_func);
+            level_shift[level_id] = shift;
+            level_mask[level_id]  = (uint64_t(1) << addr_bit_width[level_id]) - 1;
+            shift += addr_bit_width[level_id];
         }
+
+        init_hash(cfg);
     }
 
     void map(dram::addr_type_t &addr) const
     {
-        addr.mapped_addr.resize(total_levels);
-        logic_addr_t logic_addr = addr.logic_addr;
+        const logic_addr_t logic_addr = addr.logic_addr;
+        for (size_t l = 0; l < StandardType::total_levels; ++l) {
+            addr.mapped_addr[l] = (logic_addr >> level_shift[l]) & level_mask[l];
+        }
 
-        logic_addr >>= tx_bit_width;
-        for (int i = int(total_levels) - 1; i >= 0; --i) {
-            uint64_t level          = (this->code >> ((unsigned)i * 4)) & 0xfU;
-            addr.mapped_addr[level] = logic_addr & ((1U << addr_bit_width[level]) - 1);
-            logic_addr >>= addr_bit_width[level];
+        if (hashed) {
+            const uint64_t row = addr.mapped_addr[size_t(level::row)];
+            for (size_t l = 0; l < size_t(level::row); ++l) {
+                if (xor_mask[l] != 0)
+                    addr.mapped_addr[l] ^= fold(row & xor_mask[l], l);
+            }
         }
     }
 
@@ -125,6 +351,75 @@ template <typename StandardType> class dram_mapping
     {
         throw std::runtime_error("dram_mapping: reverse dram_mapping not implemented yet");
     }
+
+  private:
+    using level = typename StandardType::level;
+
+    static size_t level_index(const std::string &level_name)
+    {
+        if (level_name == "Ch")
+            return size_t(level::channel);
+        else if (level_name == "Ra")
+            return size_t(level::rank);
+        else if (level_name == "Bg")
+            return size_t(level::bank_group);
+        else if (level_name == "Ba")
+            return size_t(level::bank);
+        else if (level_name == "Ro")
+            return size_t(level::row);
+        else if (level_name == "Co")
+            return size_t(level::col);
+        return size_invalid;
+    }
+
+    void init_hash(const config &cfg)
+    {
+        std::string hash_func = cfg.check("media_mapping_hash") ? cfg.get_string("media_mapping_hash") : "none";
+
+        const level hashed_levels[] = {level::bank, level::bank_group, level::rank, level::channel};
+        if (hash_func == "none") {
+            return;
+        } else if (hash_func == "permutation") {
+            /* Consume the row bits from LSB, bank first since bank conflicts are the most expensive */
+            size_t row_bit = 0;
+            for (auto l : hashed_levels) {
+                xor_mask[size_t(l)] = level_mask[size_t(l)] << row_bit;
+                row_bit += addr_bit_width[size_t(l)];
+            }
+        } else if (hash_func == "xor") {
+            const std::string mask_keys[] = {
+                "xor_mask_bank",
+                "xor_mask_bank_group",
+                "xor_mask_rank",
+                "xor_mask_channel",
+            };
+            for (size_t i = 0; i < std::size(hashed_levels); i++) {
+                if (cfg.check(mask_keys[i]))
+                    xor_mask[size_t(hashed_levels[i])] = cfg.get_ulong(mask_keys[i]);
+            }
+        } else {
+            throw std::runtime_error("Unknown dram_mapping hash function: " + hash_func);
+        }
+
+        const uint64_t row_mask = level_mask[size_t(level::row)];
+        for (auto l : hashed_levels) {
+            xor_mask[size_t(l)] &= row_mask;
+            if (level_mask[size_t(l)] == 0)
+                xor_mask[size_t(l)] = 0;
+            hashed |= (xor_mask[size_t(l)] != 0);
+        }
+    }
+
+    /* XOR-fold the selected row bits into the width of level `l` */
+    uint64_t fold(uint64_t bits, size_t l) const
+    {
+        uint64_t ret = 0;
+        while (bits) {
+            ret ^= bits & level_mask[l];
+            bits >>= addr_bit_width[l];
+        }
+        return ret;
+    }
 };
 
 } // namespace vans
@@ -0,0 +1,242 @@
+#include "memory_mode.h"
+
+namespace vans::memory_mode
+{
+
+std::pair<size_t, addr_t> tag_store::set_and_tag(addr_t line) const
+{
+    size_t set = line & (sets - 1);
+    addr_t tag = line >> set_bits;
+    if (tag >= (addr_t(1) << (32 - tag_shift)))
+        throw std::runtime_error("memory_mode: address " + std::to_string(line << cpu_cl_bitshift)
+                                 + " is out of the tag store range.");
+    return {set, tag};
+}
+
+size_t tag_store::find_way(const uint32_t *set_entries, addr_t tag) const
+{
+    for (size_t w = 0; w < ways; w++) {
+        if ((set_entries[w] & valid_bit) && (set_entries[w] >> tag_shift) == tag)
+            return w;
+    }
+    return ways;
+}
+
+size_t tag_store::victim_way(const uint32_t *set_entries) const
+{
+    auto lru   = [](uint32_t e) { return (e >> lru_shift) & lru_mask; };
+    size_t way = 0;
+    for (size_t w = 0; w < ways; w++) {
+        if (!(set_entries[w] & valid_bit))
+            return w;
+        if (lru(set_entries[w]) > lru(set_entries[way]))
+            way = w;
+    }
+    return way;
+}
+
+tag_store::result tag_store::lookup(addr_t line) const
+{
+    auto [set, tag]             = set_and_tag(line);
+    const uint32_t *set_entries = &entries[set * ways];
+
+    size_t way = find_way(set_entries, tag);
+    bool hit   = way != ways;
+    if (!hit)
+        way = victim_way(set_entries);
+    return {hit, set * ways + way, false, 0};
+}
+
+tag_store::result tag_store::access(addr_t line, bool write)
+{
+    auto [set, tag]       = set_and_tag(line);
+    uint32_t *set_entries = &entries[set * ways];
+    auto lru              = [](uint32_t e) { return (e >> lru_shift) & lru_mask; };
+
+    result res{true, 0, false, 0};
+    size_t way = find_way(set_entries, tag);
+
+    if (way == ways) {
+        /* Miss: replace an invalid way, or the least recently used one */
+        res.hit         = false;
+        way             = victim_way(set_entries);
+        uint32_t victim = set_entries[way];
+        if ((victim & valid_bit) && (victim & dirty_bit)) {
+            res.evict_dirty = true;
+            res.evict_line  = (addr_t(victim >> tag_shift) << set_bits) | set;
+        }
+        set_entries[way] = (uint32_t(tag) << tag_shift) | (uint32_t(ways - 1) << lru_shift) | valid_bit;
+    }
+
+    /* Move the accessed way to the most recently used position */
+    uint32_t accessed_lru = lru(set_entries[way]);
+    for (size_t w = 0; w < ways; w++) {
+        if ((set_entries[w] & valid_bit) && lru(set_entries[w]) < accessed_lru)
+            set_entries[w] += (1U << lru_shift);
+    }
+    set_entries[way] &= ~(uint32_t(lru_mask) << lru_shift);
+    if (write)
+        set_entries[way] |= dirty_bit;
+
+    res.slot = set * ways + way;
+    return res;
+}
+
+void memory_mode_controller::tick(clk_t curr_clk)
+{
+    process_completions(curr_clk);
+    tick_lsq(curr_clk);
+    tick_dram(curr_clk);
+    tick_nvram(curr_clk);
+}
+
+void memory_mode_controller::tick_lsq(clk_t curr_clk)
+{
+    if (lsq.empty())
+        return;
+    /* Back pressure from the MSHRs and near memory */
+    if (inflight >= mshr_entries || dram_q.full())
+        return;
+
+    auto req = lsq.queue.front();
+    lsq.queue.pop_front();
+    inflight++;
+
+    bool is_write = req.type == base_request_type::write;
+    addr_t line   = req.addr >> cpu_cl_bitshift;
+    cnt_events[is_write ? "write_access" : "read_access"]++;
+
+    /* The line is being filled: wait for the fill, its DRAM write also carries the data of merged writes */
+    auto pending = pending_lines.find(line);
+    if (pending != pending_lines.end()) {
+        cnt_events["mshr_merge"]++;
+        pending->second.push_back(req);
+        return;
+    }
+
+    /* A hit updates the tags now, a miss installs its line once the data arrives */
+    auto res = tags.lookup(line);
+    if (res.hit)
+        res = tags.access(line, is_write);
+    else
+        pending_lines[line];
+
+    if (is_write)
+        cnt_events[res.hit ? "write_hit" : "write_miss"]++;
+    else
+        cnt_events[res.hit ? "read_hit" : "read_miss"]++;
+
+    /* Tags are stored with the data in DRAM, every access starts with a DRAM read */
+    base_request tag_read(
+        base_request_type::read, res.slot << cpu_cl_bitshift, curr_clk, [this, req, res](logic_addr_t addr, clk_t clk) {
+            completions.push_back({req, res, false, clk});
+            process_completions(clk);
+        });
+    tag_read.sample = req.sample;
+    dram_q.enqueue(tag_read);
+}
+
+void memory_mode_controller::process_completions(clk_t curr_clk)
+{
+    while (!completions.empty() && complete(completions.front(), curr_clk))
+        completions.pop_front();
+}
+
+bool memory_mode_controller::complete(const completion &c, clk_t curr_clk)
+{
+    bool is_write = c.req.type == base_request_type::write;
+
+    /* A write miss carries the whole line, it installs without a fill */
+    if (c.fill || (is_write && !c.res.hit)) {
+        if (dram_q.full() || nvram_q.full())
+            return false;
+        install(c, curr_clk);
+        return true;
+    }
+
+    if (c.res.hit) {
+        if (is_write) {
+            if (dram_q.full())
+                return false;
+            base_request data_write(base_request_type::write, c.res.slot << cpu_cl_bitshift, curr_clk);
+            data_write.sample = c.req.sample;
+            dram_q.enqueue(data_write);
+        } else if (c.req.callback) {
+            c.req.callback(c.req.addr, c.clk);
+        }
+        inflight--;
+        return true;
+    }
+
+    /* Read miss: fetch the line from NVRAM, then install it */
+    if (nvram_q.full())
+        return false;
+    addr_t far_addr = (c.req.addr >> cpu_cl_bitshift) << cpu_cl_bitshift;
+    base_request far_read(
+        base_request_type::read, far_addr, curr_clk, [this, req = c.req](logic_addr_t addr, clk_t clk) {
+            completions.push_back({req, {}, true, clk});
+            process_completions(clk);
+        });
+    far_read.sample = c.req.sample;
+    nvram_q.enqueue(far_read);
+    return true;
+}
+
+void memory_mode_controller::install(const completion &c, clk_t curr_clk)
+{
+    addr_t line  = c.req.addr >> cpu_cl_bitshift;
+    auto waiting = std::move(pending_lines.at(line));
+    pending_lines.erase(line);
+
+    bool dirty = c.req.type == base_request_type::write;
+    for (auto &req : waiting)
+        dirty |= req.type == base_request_type::write;
+
+    auto res = tags.access(line, dirty);
+    if (res.evict_dirty) {
+        cnt_events["dirty_eviction"]++;
+        base_request evict_write(base_request_type::write, res.evict_line << cpu_cl_bitshift, curr_clk);
+        evict_write.sample = c.req.sample;
+        nvram_q.enqueue(evict_write);
+    }
+    base_request fill_write(base_request_type::write, res.slot << cpu_cl_bitshift, curr_clk);
+    fill_write.sample = c.req.sample;
+    dram_q.enqueue(fill_write);
+
+    /* Writes complete once the imc accepts them into its wpq, only reads are answered here */
+    if (c.req.type == base_request_type::read && c.req.callback)
+        c.req.callback(c.req.addr, c.clk);
+    for (auto &req : waiting) {
+        if (req.type == base_request_type::read && req.callback)
+            req.callback(req.addr, c.clk);
+    }
+    inflight -= 1 + waiting.size();
+}
+
+void memory_mode_controller::tick_dram(clk_t curr_clk)
+{
+    if (dram_q.empty() || this->local_memory_model->full())
+        return;
+
+    auto [issued, deterministic, next_clk] = this->local_memory_model->issue_request(dram_q.queue.front());
+    if (issued)
+        dram_q.queue.pop_front();
+}
+
+void memory_mode_controller::tick_nvram(clk_t curr_clk)
+{
+    if (nvram_q.empty())
+        return;
+
+    auto req                   = nvram_q.queue.front();
+    auto [next_addr, next]     = this->get_next_level(req.addr);
+    req.addr                   = next_addr;
+    if (next->full())
+        return;
+
+    auto [issued, deterministic, next_clk] = next->issue_request(req);
+    if (issued)
+        nvram_q.queue.pop_front();
+}
+
+} // namespace vans::memory_mode
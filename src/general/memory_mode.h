@@ -0,0 +1,220 @@
+#ifndef VANS_MEMORY_MODE_H
+#define VANS_MEMORY_MODE_H
+
+#include "component.h"
+#include "controller.h"
+#include "factory.h"
+#include "request_queue.h"
+#include "utils.h"
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace vans::memory_mode
+{
+
+/* tag_store: tags of the DRAM cache, one 32-bit entry per cache line
+ *   entry layout: [tag (26 bits) | lru (4 bits) | dirty (1 bit) | valid (1 bit)]
+ *   ways of a set are contiguous, a cache line stays in its way until evicted
+ */
+class tag_store
+{
+    enum : uint32_t {
+        valid_bit = 0x1,
+        dirty_bit = 0x2,
+        lru_shift = 2,
+        lru_mask  = 0xf,
+        tag_shift = 6,
+    };
+
+    std::vector<uint32_t> entries;
+    size_t ways;
+    size_t sets;
+    size_t set_bits = 0;
+
+    /* Way of tag in the set, `ways` if absent */
+    [[nodiscard]] size_t find_way(const uint32_t *set_entries, addr_t tag) const;
+    /* An invalid way, or the least recently used one */
+    [[nodiscard]] size_t victim_way(const uint32_t *set_entries) const;
+    [[nodiscard]] std::pair<size_t, addr_t> set_and_tag(addr_t line) const;
+
+  public:
+    struct result {
+        bool hit;
+        size_t slot;       /* Index of the cache line in DRAM */
+        bool evict_dirty;  /* A dirty line is evicted to make room */
+        addr_t evict_line; /* Line address of the evicted line */
+    };
+
+    tag_store() = delete;
+
+    tag_store(size_t total_lines, size_t ways) : ways(ways)
+    {
+        if (ways == 0 || ways > lru_mask + 1)
+            throw std::runtime_error("memory_mode associativity should be in [1, 16].");
+        sets = total_lines / ways;
+        if (!is_pwr_of_2(sets))
+            throw std::runtime_error("memory_mode set count is not power of 2.");
+        while ((size_t(1) << set_bits) < sets)
+            set_bits++;
+        entries.resize(sets * ways, 0);
+    }
+
+    /* Look up line without changing the tags, a miss reports the slot it would replace */
+    [[nodiscard]] result lookup(addr_t line) const;
+
+    /* Look up line, allocate it on a miss, and update LRU and dirty bits */
+    result access(addr_t line, bool write);
+
+    void serialize(checkpoint &ckpt)
+    {
+        auto size = entries.size();
+        ckpt.io(entries);
+        if (entries.size() != size)
+            throw std::runtime_error("checkpoint memory_mode tag store has a different size or associativity.");
+    }
+};
+
+class memory_mode_controller : public memory_controller<vans::base_request, base_component>
+{
+  public:
+    tag_store tags;
+    base_request_queue lsq;
+    /* Requests to the near memory (DRAM cache) and far memory (next level), `lsq_entries` each */
+    base_request_queue dram_q;
+    base_request_queue nvram_q;
+
+    /* A returned tag check or NVRAM fill, handled in order once dram_q/nvram_q have room for its requests */
+    struct completion {
+        base_request req;
+        tag_store::result res;
+        bool fill;
+        clk_t clk;
+    };
+    std::deque<completion> completions;
+
+    /* Lines from a tag miss to their install, with the requests merged into them (MSHRs) */
+    std::unordered_map<addr_t, std::vector<base_request>> pending_lines;
+    /* Requests between the lsq and their completion, at most `mshr_entries` */
+    size_t inflight = 0;
+    size_t mshr_entries;
+
+    vans::counter cnt_events{"memory_mode",
+                             "events",
+                             {
+                                 "read_access",
+                                 "write_access",
+                                 "read_hit",
+                                 "read_miss",
+                                 "write_hit",
+                                 "write_miss",
+                                 "dirty_eviction",
+                                 "mshr_merge",
+                             }};
+
+    memory_mode_controller() = delete;
+    explicit memory_mode_controller(const config &cfg, std::shared_ptr<base_component> memory) :
+        memory_controller(cfg),
+        tags((cfg.get_ulong("size") << 20) >> cpu_cl_bitshift,
+             cfg.check("associativity") ? cfg.get_ulong("associativity") : 1),
+        lsq(cfg.get_ulong("lsq_entries")),
+        dram_q(cfg.get_ulong("lsq_entries")),
+        nvram_q(cfg.get_ulong("lsq_entries")),
+        mshr_entries(cfg.check("mshr_entries") ? cfg.get_ulong("mshr_entries") : cfg.get_ulong("lsq_entries"))
+    {
+        if (mshr_entries == 0)
+            throw std::runtime_error("memory_mode mshr_entries must be positive.");
+        this->local_memory_model = std::move(memory);
+    }
+
+    base_response issue_request(base_request &request) override
+    {
+        bool issued = lsq.enqueue(request);
+        return {(issued), false, clk_invalid};
+    }
+
+    bool full() override
+    {
+        return lsq.full();
+    }
+
+    void warm(const base_request &req) override
+    {
+        bool is_write = req.type == base_request_type::write;
+        addr_t line   = req.addr >> cpu_cl_bitshift;
+        auto res      = tags.access(line, is_write);
+        if (res.evict_dirty)
+            this->warm_next_level(base_request_type::write, res.evict_line << cpu_cl_bitshift, req.arrive);
+        if (!res.hit && !is_write)
+            this->warm_next_level(base_request_type::read, line << cpu_cl_bitshift, req.arrive);
+    }
+
+    void drain_current() override {}
+
+    bool pending_current() override
+    {
+        return lsq.pending() || dram_q.pending() || nvram_q.pending() || inflight != 0
+               || this->local_memory_model->pending();
+    }
+
+    void tick(clk_t curr_clk) override;
+
+    void print_counters() final
+    {
+        this->cnt_events.print(this->counter_dumper);
+    }
+
+    void register_stats(stats_registry &stats, const std::string &component) final
+    {
+        stats.add_counter(component, this->cnt_events);
+        stats.add_gauge(component + ".lsq", [this]() { return this->lsq.size(); });
+        stats.add_gauge(component + ".dram_q", [this]() { return this->dram_q.size(); });
+        stats.add_gauge(component + ".nvram_q", [this]() { return this->nvram_q.size(); });
+        stats.add_gauge(component + ".mshr", [this]() { return this->pending_lines.size(); });
+    }
+
+    void serialize(checkpoint &ckpt) final
+    {
+        ckpt.expect_idle(lsq.empty() && dram_q.empty() && nvram_q.empty() && inflight == 0, "memory_mode");
+        ckpt.io(tags);
+        ckpt.io(cnt_events);
+    }
+
+  private:
+    void tick_lsq(clk_t curr_clk);
+    void tick_dram(clk_t curr_clk);
+    void tick_nvram(clk_t curr_clk);
+    void process_completions(clk_t curr_clk);
+    bool complete(const completion &c, clk_t curr_clk);
+    void install(const completion &c, clk_t curr_clk);
+};
+
+/* memory_mode: a DRAM cache (any `standard` of `factory::make_dram_memory`) in front of the next level NVRAM */
+class memory_mode : public component<memory_mode_controller, base_component>
+{
+  public:
+    memory_mode() = delete;
+
+    explicit memory_mode(const config &cfg) : component(cfg)
+    {
+        this->memory_component = factory::make_dram_memory(cfg);
+        this->ctrl             = std::make_shared<memory_mode_controller>(cfg, this->memory_component);
+    }
+
+    base_response issue_request(base_request &req) override
+    {
+        return this->issue_tracked_request(req);
+    }
+
+    /* The next level nvram_system has its own stats file */
+    void connect_dumper(std::shared_ptr<dumper> dumper) override
+    {
+        this->stat_dumper          = dumper;
+        this->ctrl->counter_dumper = dumper;
+        this->memory_component->connect_dumper(dumper);
+    }
+};
+
+} // namespace vans::memory_mode
+
+#endif // VANS_MEMORY_MODE_H
@@ -0,0 +1,213 @@
+#ifndef VANS_MRC_H
+#define VANS_MRC_H
+
+#include "common.h"
+#include "config.h"
+#include "mapping.h"
+#include "utils.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vans::mrc
+{
+
+/* Reuse distances of one block stream, with fixed-rate SHARDS sampling
+ *   Only blocks whose hash falls in 1 of `sample_blocks` buckets are tracked, every sampled access stands for
+ *   `sample_blocks` accesses. The distance of a sampled access is the number of distinct sampled blocks accessed since
+ *   the last access of its block: a fenwick tree marks the last access time of every block. A sampled distance `d`
+ *   covers the distances [d, d + 1) * `sample_blocks` of the full stream.
+ */
+class reuse_distance
+{
+  private:
+    size_t sample_blocks;
+    size_t accesses = 0;
+    size_t sampled  = 0;
+    size_t now      = 0;
+    std::vector<int64_t> marks; /* Fenwick tree over sampled access times, 1-based */
+    std::unordered_map<addr_t, size_t> last_access;
+
+    std::map<size_t, double> distances; /* Sampled distance to scaled access count */
+    double cold = 0;
+
+    static uint64_t hash(uint64_t x)
+    {
+        /* splitmix64 finalizer */
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    void mark(size_t t, int64_t v)
+    {
+        for (; t < marks.size(); t += t & (~t + 1))
+            marks[t] += v;
+    }
+
+    [[nodiscard]] int64_t prefix(size_t t) const
+    {
+        int64_t sum = 0;
+        for (; t != 0; t -= t & (~t + 1))
+            sum += marks[t];
+        return sum;
+    }
+
+    /* Renumber the live blocks by their last access, the time axis stays within twice the sampled blocks */
+    void compact()
+    {
+        std::vector<std::pair<size_t, addr_t>> live;
+        live.reserve(last_access.size());
+        for (auto &[block, t] : last_access)
+            live.emplace_back(t, block);
+        std::sort(live.begin(), live.end());
+
+        marks.assign(std::max(live.size() * 2 + 2, size_t(1024)), 0);
+        now = 0;
+        for (auto &[t, block] : live) {
+            last_access[block] = ++now;
+            mark(now, 1);
+        }
+    }
+
+  public:
+    reuse_distance() = delete;
+
+    explicit reuse_distance(size_t sample_blocks) : sample_blocks(std::max(sample_blocks, size_t(1))) {}
+
+    void access(addr_t block)
+    {
+        accesses++;
+        if (hash(block) % sample_blocks != 0)
+            return;
+
+        sampled++;
+        if (now + 1 >= marks.size())
+            compact();
+        now++;
+
+        auto scale = double(sample_blocks);
+        auto it    = last_access.find(block);
+        if (it == last_access.end()) {
+            cold += scale;
+            last_access.emplace(block, now);
+        } else {
+            auto d = size_t(prefix(now - 1) - prefix(it->second));
+            distances[d] += scale;
+            mark(it->second, -1);
+            it->second = now;
+        }
+        mark(now, 1);
+    }
+
+    /* Miss ratio of an LRU buffer of `entries` blocks
+     *   The accesses of a sampled distance are spread evenly over the distances it covers, so buffers smaller than
+     *   `sample_blocks` do not all look like hits.
+     *   SHARDS-adj: the gap between the expected (`accesses / sample_blocks`) and the actual number of sampled
+     *   accesses is credited to the smallest distance, i.e. as hits, so the scaled misses are divided by all accesses.
+     *   This removes most of the bias of a sample that happens to hold hot or cold blocks.
+     */
+    [[nodiscard]] double miss_ratio(size_t entries) const
+    {
+        if (accesses == 0)
+            return 0;
+        if (entries == 0)
+            return 1;
+        double misses = cold;
+        auto scale    = double(sample_blocks);
+        for (auto it = distances.lower_bound(entries / sample_blocks); it != distances.end(); it++)
+            misses += it->second * std::min(1.0, (double(it->first + 1) * scale - double(entries)) / scale);
+        return std::clamp(misses / double(accesses), 0.0, 1.0);
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return accesses;
+    }
+
+    /* Largest distance, buffers beyond it only miss on cold blocks */
+    [[nodiscard]] size_t max_distance() const
+    {
+        return distances.empty() ? 0 : (distances.rbegin()->first + 1) * sample_blocks - 1;
+    }
+};
+
+/* Buffer levels of a DIMM, by block granularity */
+enum class level { rmw, ait, total };
+
+static const char *const level_name[] = {"rmw", "ait"};
+
+/* Reuse distances of the rmw and ait blocks of every DIMM under `[imc] component_mapping_func` */
+class analyzer
+{
+  private:
+    component_mapping_f dimm_mapping;
+    size_t dimms;
+    addr_t start_addr = 0;
+
+  public:
+    /* Indexed by DIMM, then by `level` */
+    std::vector<std::vector<reuse_distance>> streams;
+
+    analyzer() = delete;
+
+    analyzer(const root_config &cfg, size_t sample_blocks)
+    {
+        dimms = 0;
+        for (auto &org : cfg.get_organizations("imc"))
+            dimms += org.count;
+        dimms        = std::max(dimms, size_t(1));
+        dimm_mapping = get_component_mapping_func(cfg["imc"]["component_mapping_func"], dimms);
+        if (cfg["rmc"].check("start_addr"))
+            start_addr = cfg["rmc"].get_ulong("start_addr");
+        streams.resize(dimms, std::vector<reuse_distance>(size_t(level::total), reuse_distance(sample_blocks)));
+    }
+
+    /* Buffers see the DIMM local address */
+    void add(logic_addr_t addr)
+    {
+        auto [dimm_addr, dimm] = dimm_mapping(addr >= start_addr ? addr - start_addr : addr);
+        streams[dimm][size_t(level::rmw)].access(rmw::translate_to_block_addr(dimm_addr));
+        streams[dimm][size_t(level::ait)].access(ait::translate_to_block_addr(dimm_addr));
+    }
+
+    /* Buffer sizes of the curves: 4 points per power of 2, up to the largest distance of any stream */
+    [[nodiscard]] std::vector<size_t> curve_sizes() const
+    {
+        size_t max = 1;
+        for (auto &dimm : streams)
+            for (auto &s : dimm)
+                max = std::max(max, s.max_distance() + 1);
+
+        std::vector<size_t> sizes{1, 2, 3};
+        for (size_t base = 4; sizes.back() < max; base *= 2) {
+            for (size_t step = 0; step < 4; step++)
+                sizes.push_back(base + step * base / 4);
+        }
+        return sizes;
+    }
+
+    /* CSV: dimm,level,entries,miss_ratio */
+    void write_csv(const std::string &filename) const
+    {
+        std::ofstream file(filename);
+        if (!file.good())
+            throw std::runtime_error("cannot open miss ratio curve file: " + filename);
+        auto sizes = curve_sizes();
+        file << "dimm,level,entries,miss_ratio\n";
+        for (size_t d = 0; d < streams.size(); d++) {
+            for (size_t l = 0; l < size_t(level::total); l++) {
+                for (auto entries : sizes)
+                    file << d << "," << level_name[l] << "," << entries << "," << streams[d][l].miss_ratio(entries)
+                         << "\n";
+            }
+        }
+    }
+};
+
+} // namespace vans::mrc
+
+#endif // VANS_MRC_H
@@ -5,11 +5,47 @@
 
 namespace vans
 {
+
+/* PMEM media request trace (`[dump] pmem_trace_dump`), one binary file per nv_media
+ *   header : "VANSPMEM", uint32 record size
+ *   records: one `pmem_req_record` (little-endian) per request, type 0 is read and 1 is write
+ */
+#pragma pack(push, 1)
+struct pmem_req_record {
+    uint64_t clk;
+    uint64_t addr;
+    uint8_t type;
+};
+#pragma pack(pop)
+
 class nv_media : public static_memory
 {
+    std::unique_ptr<async_writer> req_trace = nullptr;
+
   public:
     nv_media() = delete;
     explicit nv_media(const config &cfg) : static_memory(cfg) {}
+
+    void open_trace_dumps(const root_config &cfg) override
+    {
+        if (!dump_enabled(cfg, "pmem_trace_dump"))
+            return;
+
+        req_trace = std::make_unique<async_writer>(get_dump_filename(cfg, "pmem_trace_dump", this->id, this->name));
+        uint32_t record_size = sizeof(pmem_req_record);
+        req_trace->write("VANSPMEM", 8);
+        req_trace->write(&record_size, sizeof(record_size));
+    }
+
+    base_response issue_request(base_request &req) override
+    {
+        auto res = static_memory::issue_request(req);
+        if (req_trace && std::get<0>(res)) {
+            pmem_req_record rec{req.arrive, req.addr, uint8_t(req.type)};
+            req_trace->write(&rec, sizeof(rec));
+        }
+        return res;
+    }
 };
 } // namespace vans
 
@@ -21,6 +21,11 @@ class nvram_system_controller : public memory_controller<vans::base_request, van
         return next_component->issue_request(request);
     }
 
+    void warm(const base_request &req) override
+    {
+        this->warm_next_level(req.type, req.addr, req.arrive);
+    }
+
     bool full() override
     {
         return std::any_of(
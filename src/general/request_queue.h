@@ -7,6 +7,7 @@
 #include <deque>
 #include <functional>
 #include <utility>
+#include <vector>
 
 namespace vans
 {
@@ -37,7 +38,7 @@ template <typename RequestType> struct request_queue {
         return !empty();
     }
 
-    [[nodiscard]] bool size() const
+    [[nodiscard]] size_t size() const
     {
         return queue.size();
     }
@@ -58,6 +59,60 @@ struct base_request_queue : public request_queue<base_request> {
     explicit base_request_queue(size_t max_entries) : request_queue(max_entries) {}
 };
 
+/* virtual_request_queue:
+ *   Per-target FIFOs sharing one capacity, so requests to a blocked target do
+ *   not block requests to other targets behind it.
+ */
+template <typename RequestType> struct virtual_request_queue {
+    std::vector<std::deque<RequestType>> queues;
+    size_t max_entries;
+    size_t entries = 0;
+
+    virtual_request_queue() = delete;
+    explicit virtual_request_queue(size_t max_entries) : max_entries(max_entries) {}
+
+    [[nodiscard]] bool full() const
+    {
+        if (entries > max_entries)
+            throw std::runtime_error("Internal error: queue overflow, " + std::to_string(entries) + " > "
+                                     + std::to_string(max_entries));
+        return entries == max_entries;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return entries == 0;
+    }
+
+    [[nodiscard]] bool pending() const
+    {
+        return !empty();
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return entries;
+    }
+
+    bool enqueue(RequestType &req, size_t target)
+    {
+        if (full())
+            return false;
+
+        if (target >= queues.size())
+            queues.resize(target + 1);
+        queues[target].push_back(req);
+        entries++;
+        return true;
+    }
+
+    void pop_front(size_t target)
+    {
+        queues[target].pop_front();
+        entries--;
+    }
+};
+
 } // namespace vans
 
 #endif // VANS_REQUEST_QUEUE_H
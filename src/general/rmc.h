@@ -34,6 +34,15 @@ class rmc_controller : public memory_controller<vans::base_request, vans::static
         return next_component->issue_request(request);
     }
 
+    void warm(const base_request &req) override
+    {
+        if (req.addr < this->start_addr) {
+            throw std::runtime_error("Internal error, incoming address " + std::to_string(req.addr)
+                                     + " is lower than rmc's start address " + std::to_string(this->start_addr));
+        }
+        this->warm_next_level(req.type, req.addr - this->start_addr, req.arrive);
+    }
+
     bool full() override
     {
         throw std::runtime_error("Internal error, function not supposed to be invoked.");
@@ -52,6 +61,9 @@ class rmc_controller : public memory_controller<vans::base_request, vans::static
 class rmc : public component<rmc_controller, static_memory>
 {
   public:
+    /* Optional epoch time series of the whole component tree, dumped before the tree ticks */
+    std::shared_ptr<epoch_stats> epoch = nullptr;
+
     rmc() = delete;
 
     explicit rmc(const config &cfg)
@@ -63,6 +75,26 @@ class rmc : public component<rmc_controller, static_memory>
     {
         return this->ctrl->issue_request(req);
     }
+
+    void serialize(checkpoint &ckpt) override
+    {
+        component::serialize(ckpt);
+        if (this->epoch && ckpt.restoring())
+            this->epoch->restart(this->arrive_clk);
+    }
+
+    clk_t next_event(clk_t curr_clk) override
+    {
+        clk_t clk = component::next_event(curr_clk);
+        return this->epoch ? std::min(clk, this->epoch->next_dump(curr_clk)) : clk;
+    }
+
+    void tick_current(clk_t curr_clk) override
+    {
+        if (this->epoch)
+            this->epoch->tick(curr_clk);
+        component::tick_current(curr_clk);
+    }
 };
 } // namespace vans::rmc
 
@@ -11,14 +11,7 @@ bool rmw_controller::check_and_evict()
         return false;
 
     /* LRU eviction */
-    block_addr_t oldest_addr = addr_invalid;
-    clk_t oldest_clk         = clk_invalid;
-    for (auto &entry : buffer.entry_map) {
-        if (entry.second.state == request_state::end && entry.second.last_used_clk < oldest_clk) {
-            oldest_clk  = entry.second.last_used_clk;
-            oldest_addr = entry.first;
-        }
-    }
+    block_addr_t oldest_addr = buffer.lru_entry(idle_entry);
 
     if (oldest_addr == addr_invalid) {
         /* All busy, cannot evict */
@@ -36,6 +29,42 @@ base_response rmw_controller::issue_request(base_request &req)
     return {(success), false, clk_invalid};
 }
 
+/* rmw::rmw_controller::warm()
+ *   Leave the block in the buffer as a finished request would: a read miss or a partial write miss reads the block from
+ *   the next level, and every write is written back to the next level.
+ */
+void rmw_controller::warm(const base_request &req)
+{
+    bool is_write   = req.type == base_request_type::write;
+    auto block_addr = translate_to_block_addr(req.addr);
+    auto entry_pair = this->buffer.find(block_addr);
+    if (entry_pair == this->buffer.end()) {
+        if (this->buffer.full()) {
+            auto victim = this->buffer.lru_entry(idle_entry);
+            if (victim == addr_invalid)
+                throw std::runtime_error("Internal error, warming an rmw with every entry in flight.");
+            this->buffer.erase(victim);
+        }
+        entry_pair = this->buffer.insert(block_addr,
+                                         req.arrive,
+                                         is_write ? request_type::write_rmw : request_type::read_cold,
+                                         req.addr,
+                                         block_bitshift_cl(req.addr));
+        this->warm_next_level(base_request_type::read, block_addr, req.arrive);
+    }
+    if (is_write)
+        this->warm_next_level(base_request_type::write, block_addr, req.arrive);
+
+    auto &entry                     = entry_pair->second;
+    entry.pending                   = false;
+    entry.waiting_action_clk_update = false;
+    entry.valid_to_read             = true;
+    entry.dirty                     = false;
+    entry.state                     = request_state::end;
+    entry.last_used_clk             = req.arrive;
+    entry.next_action_clk           = req.arrive;
+}
+
 void rmw_controller::drain_current()
 {
     for (auto &entry_pair : this->buffer.entry_map) {
@@ -55,6 +84,7 @@ void rmw_controller::init_state_trans_table()
         [this](const decltype(this->get_next_level(addr_invalid)) &next, buffer_entry &entry, clk_t curr_clk) {
             block_addr_t rmw_addr = translate_to_block_addr(entry.pending_request.logic_addr);
             base_request req{vans::base_request_type::read, rmw_addr, curr_clk, this->next_level_read_callback};
+            req.sample           = entry.sample;
             auto &next_component = std::get<1>(next);
             return next_component->issue_request(req);
         };
@@ -62,17 +92,20 @@ void rmw_controller::init_state_trans_table()
         [this](const decltype(this->get_next_level(addr_invalid)) &next, buffer_entry &entry, clk_t curr_clk) {
             block_addr_t rmw_addr = translate_to_block_addr(entry.pending_request.logic_addr);
             base_request req{vans::base_request_type::write, rmw_addr, curr_clk, nullptr};
+            req.sample           = entry.sample;
             auto &next_component = std::get<1>(next);
             return next_component->issue_request(req);
         };
 
     const auto issue_write_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
         base_request req{base_request_type::write, entry.pending_request.logic_addr, curr_clk, nullptr};
+        req.sample = entry.sample;
         return this->local_memory_model->issue_request(req);
     };
 
     const auto issue_read_local_memory = [this](buffer_entry &entry, clk_t curr_clk) {
         base_request req{base_request_type::read, entry.pending_request.logic_addr, curr_clk, nullptr};
+        req.sample = entry.sample;
         return this->local_memory_model->issue_request(req);
     };
 
@@ -616,9 +649,14 @@ void rmw_controller::tick_lsq_read(clk_t curr_clk)
     }
 
     if (req_served) {
-        if (!req_patch)
-            entry_pair->second.reset_callback();
-        entry_pair->second.assign_callback(cl_index, front_req.callback);
+        auto &entry = entry_pair->second;
+        if (!req_patch) {
+            entry.reset_callback();
+            entry.sample = front_req.sample;
+        } else if (front_req.sample == trace_sample::sampled) {
+            entry.sample = trace_sample::sampled;
+        }
+        entry.assign_callback(cl_index, front_req.callback);
         lsq.queue.pop_front();
         cnt_events["read_access"]++;
     }
@@ -657,6 +695,7 @@ void rmw_controller::tick_lsq_write(clk_t curr_clk)
 
     unsigned num_write_req_served = 0;
     buffer_entry::bitmap_t cl_hit = 0;
+    auto sample                   = patch_rmw ? entry_pair->second.sample : front_req.sample;
 
     /* Write combining, stop at a read request to the current block */
     for (auto req = lsq.queue.begin(); req != lsq.queue.end();) {
@@ -670,7 +709,9 @@ void rmw_controller::tick_lsq_write(clk_t curr_clk)
             } else if (req->type == base_request_type::write) {
                 /* Combine the current write request */
                 cl_hit[block_offset_cl(req->addr)] = true;
-                req                                = lsq.queue.erase(req);
+                if (req->sample == trace_sample::sampled)
+                    sample = trace_sample::sampled;
+                req = lsq.queue.erase(req);
                 num_write_req_served++;
             } else {
                 throw std::runtime_error("Internal error, unknown request type in lsq.");
@@ -706,6 +747,8 @@ void rmw_controller::tick_lsq_write(clk_t curr_clk)
         }
     }
 
+    entry_pair->second.sample = sample;
+
     /* NOTE: a combined write request counts as one request in this counter */
     cnt_events["write_access"]++;
 }
@@ -737,7 +780,11 @@ void rmw_controller::tick_internal_buffer(clk_t curr_clk)
         if (func == nullptr) {
             throw std::runtime_error("Internal error, unknown state transfer.");
         }
+        auto prev_state = entry.state;
         func(curr_block_addr, entry, curr_clk);
+        if (this->tracer && entry.state != prev_state && this->tracer->sampled(entry.sample, curr_block_addr)) {
+            this->tracer->instant(this->trace_track, request_state_name[int(entry.state)], curr_block_addr, curr_clk);
+        }
     }
 }
 } // namespace vans::rmw
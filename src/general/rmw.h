@@ -35,6 +35,18 @@ enum class request_state {
     total
 };
 
+/* Names of `request_state`, for span traces */
+static const char *const request_state_name[] = {
+    "init",
+    "pending_read",
+    "pending_modify",
+    "pending_write",
+    "pending_readout",
+    "pending_ait_r",
+    "pending_ait_w",
+    "end",
+};
+
 struct request {
     request_type type;
     logic_addr_t logic_addr;
@@ -80,6 +92,7 @@ struct buffer_entry {
     /* Pending requests */
     request pending_request;
     request_state state = request_state::init;
+    trace_sample sample = trace_sample::undecided; /* Of the requests served, not saved in checkpoints */
     std::deque<unsigned> pending_request_cl_index;
 
     /* Methods */
@@ -130,6 +143,24 @@ struct buffer_entry {
         }
     }
 
+    void serialize(checkpoint &ckpt)
+    {
+        ckpt.expect_idle(!pending && pending_request_cl_index.empty(), "a pending rmw buffer entry");
+        bool flags[4] = {pending, waiting_action_clk_update, valid_to_read, dirty};
+        ckpt.io(flags);
+        pending                   = flags[0];
+        waiting_action_clk_update = flags[1];
+        valid_to_read             = flags[2];
+        dirty                     = flags[3];
+        ckpt.io(last_used_clk);
+        ckpt.io(next_action_clk);
+        ckpt.io(buffer_index);
+        ckpt.io(cl_bitmap);
+        ckpt.io(cb_bitmap);
+        ckpt.io(pending_request);
+        ckpt.io(state);
+    }
+
     [[maybe_unused]] [[nodiscard]] std::string to_string() const
     {
         std::string str;
@@ -140,6 +171,12 @@ struct buffer_entry {
     }
 };
 
+/* Only finished entries can be evicted */
+static inline bool idle_entry(const buffer_entry &entry)
+{
+    return entry.state == request_state::end;
+}
+
 class rmw_controller : public memory_controller<vans::base_request, static_memory>
 {
   public:
@@ -236,6 +273,19 @@ class rmw_controller : public memory_controller<vans::base_request, static_memor
 
     base_response issue_request(base_request &req) final;
 
+    void warm(const base_request &req) final;
+
+    void reconfigure(const vans::config &cfg) final
+    {
+        this->timing.ait_to_rmw_latency = cfg.get_ulong("ait_to_rmw_latency");
+        this->timing.rmw_to_ait_latency = cfg.get_ulong("rmw_to_ait_latency");
+    }
+
+    [[nodiscard]] std::vector<std::string> reconfigure_keys(const vans::config &cfg) const final
+    {
+        return {"ait_to_rmw_latency", "rmw_to_ait_latency"};
+    }
+
     /* rmw::rmw_controller::drain()
      *   Call once and then tick. This function mark all the dirty rmw entries to be flushed. */
     void drain_current() final;
@@ -258,6 +308,24 @@ class rmw_controller : public memory_controller<vans::base_request, static_memor
         this->cnt_duration.print(this->counter_dumper);
     }
 
+    void register_stats(stats_registry &stats, const std::string &component) final
+    {
+        stats.add_counter(component, this->cnt_events);
+        stats.add_counter(component, this->cnt_duration);
+        stats.add_gauge(component + ".lsq", [this]() { return this->lsq.size(); });
+        stats.add_gauge(component + ".roq", [this]() { return this->roq.size(); });
+        stats.add_gauge(component + ".buffer", [this]() { return this->buffer.entry_map.size(); });
+    }
+
+    void serialize(checkpoint &ckpt) final
+    {
+        ckpt.expect_idle(lsq.empty() && roq.empty(), "rmw");
+        ckpt.io(buffer);
+        ckpt.io(evicting);
+        ckpt.io(cnt_events);
+        ckpt.io(cnt_duration);
+    }
+
   private:
     void tick_roq(clk_t curr_clk);
     void tick_lsq(clk_t curr_clk);
@@ -279,7 +347,7 @@ class rmw : public component<rmw_controller, vans::static_memory>
 
     base_response issue_request(base_request &req) final
     {
-        return this->ctrl->issue_request(req);
+        return this->issue_tracked_request(req);
     }
 };
 } // namespace vans::rmw
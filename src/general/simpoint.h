@@ -0,0 +1,262 @@
+#ifndef VANS_SIMPOINT_H
+#define VANS_SIMPOINT_H
+
+#include "common.h"
+#include "config.h"
+#include "mapping.h"
+#include "utils.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace vans::simpoint
+{
+
+/* Signature of one trace interval, every feature is a fraction of the interval's requests:
+ *   write ratio, 256B (rmw) and 4KB (ait) block reuse within the interval, and the share of each DIMM under the
+ *   `[imc] component_mapping_func`
+ */
+class signature_builder
+{
+  private:
+    component_mapping_f dimm_mapping;
+    size_t dimms;
+    addr_t start_addr = 0;
+
+    std::unordered_set<addr_t> blocks_rmw;
+    std::unordered_set<addr_t> blocks_ait;
+    size_t requests  = 0;
+    size_t writes    = 0;
+    size_t reuse_rmw = 0;
+    size_t reuse_ait = 0;
+    std::vector<size_t> dimm_requests;
+
+  public:
+    signature_builder() = delete;
+
+    explicit signature_builder(const root_config &cfg)
+    {
+        dimms = 0;
+        for (auto &org : cfg.get_organizations("imc"))
+            dimms += org.count;
+        dimms        = std::max(dimms, size_t(1));
+        dimm_mapping = get_component_mapping_func(cfg["imc"]["component_mapping_func"], dimms);
+        if (cfg["rmc"].check("start_addr"))
+            start_addr = cfg["rmc"].get_ulong("start_addr");
+        dimm_requests.resize(dimms, 0);
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return requests;
+    }
+
+    void add(logic_addr_t addr, base_request_type type)
+    {
+        requests++;
+        if (type == base_request_type::write)
+            writes++;
+        if (!blocks_rmw.insert(rmw::translate_to_block_addr(addr)).second)
+            reuse_rmw++;
+        if (!blocks_ait.insert(ait::translate_to_block_addr(addr)).second)
+            reuse_ait++;
+        auto [dimm_addr, dimm] = dimm_mapping(addr >= start_addr ? addr - start_addr : addr);
+        dimm_requests[dimm]++;
+    }
+
+    /* The signature of the requests added since the last call */
+    std::vector<double> finish()
+    {
+        double n = requests != 0 ? double(requests) : 1;
+        std::vector<double> sig{double(writes) / n, double(reuse_rmw) / n, double(reuse_ait) / n};
+        for (auto &cnt : dimm_requests) {
+            sig.push_back(double(cnt) / n);
+            cnt = 0;
+        }
+        blocks_rmw.clear();
+        blocks_ait.clear();
+        requests  = 0;
+        writes    = 0;
+        reuse_rmw = 0;
+        reuse_ait = 0;
+        return sig;
+    }
+};
+
+using point_t = std::vector<double>;
+
+static inline double distance2(const point_t &a, const point_t &b)
+{
+    double d = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        d += (a[i] - b[i]) * (a[i] - b[i]);
+    return d;
+}
+
+/* k-means with k-means++ seeding from a fixed seed, so a trace always gives the same clusters
+ *   Returns the cluster of each point, `centroids` and `sse` (sum of squared distances) describe the result.
+ */
+static std::vector<size_t>
+kmeans(const std::vector<point_t> &points, size_t k, std::vector<point_t> &centroids, double &sse)
+{
+    std::mt19937_64 rng(0);
+    std::vector<double> nearest(points.size(), std::numeric_limits<double>::max());
+
+    centroids.clear();
+    centroids.push_back(points[rng() % points.size()]);
+    while (centroids.size() < k) {
+        double total = 0;
+        for (size_t i = 0; i < points.size(); i++) {
+            nearest[i] = std::min(nearest[i], distance2(points[i], centroids.back()));
+            total += nearest[i];
+        }
+        if (total == 0)
+            break;
+        double pick = std::uniform_real_distribution<double>(0, total)(rng);
+        size_t next = 0;
+        for (; next + 1 < points.size() && pick >= nearest[next]; next++)
+            pick -= nearest[next];
+        centroids.push_back(points[next]);
+    }
+
+    std::vector<size_t> cluster(points.size(), 0);
+    for (int iter = 0; iter < 100; iter++) {
+        bool changed = false;
+        for (size_t i = 0; i < points.size(); i++) {
+            size_t best = 0;
+            for (size_t c = 1; c < centroids.size(); c++) {
+                if (distance2(points[i], centroids[c]) < distance2(points[i], centroids[best]))
+                    best = c;
+            }
+            changed |= best != cluster[i];
+            cluster[i] = best;
+        }
+        if (!changed && iter != 0)
+            break;
+
+        std::vector<point_t> sum(centroids.size(), point_t(points[0].size(), 0));
+        std::vector<size_t> cnt(centroids.size(), 0);
+        for (size_t i = 0; i < points.size(); i++) {
+            for (size_t d = 0; d < points[i].size(); d++)
+                sum[cluster[i]][d] += points[i][d];
+            cnt[cluster[i]]++;
+        }
+        for (size_t c = 0; c < centroids.size(); c++) {
+            if (cnt[c] == 0)
+                continue;
+            for (size_t d = 0; d < sum[c].size(); d++)
+                centroids[c][d] = sum[c][d] / double(cnt[c]);
+        }
+    }
+
+    sse = 0;
+    for (size_t i = 0; i < points.size(); i++)
+        sse += distance2(points[i], centroids[cluster[i]]);
+    return cluster;
+}
+
+/* One representative interval, its weight is the share of all intervals in its cluster */
+struct representative {
+    size_t interval;
+    double weight;
+};
+
+/* Cluster the interval signatures with up to `max_clusters` clusters and pick the interval closest to each centroid
+ *   The smallest k that reaches 90% of the SSE reduction of `max_clusters` is used, more clusters barely improve the
+ *   fit but cost more simulated intervals.
+ */
+static std::vector<representative> select(const std::vector<point_t> &signatures, size_t max_clusters)
+{
+    if (signatures.empty())
+        return {};
+    max_clusters = std::max(size_t(1), std::min(max_clusters, signatures.size()));
+
+    std::vector<std::vector<size_t>> clusters(max_clusters + 1);
+    std::vector<std::vector<point_t>> centroids(max_clusters + 1);
+    std::vector<double> sse(max_clusters + 1, 0);
+    for (size_t k = 1; k <= max_clusters; k++)
+        clusters[k] = kmeans(signatures, k, centroids[k], sse[k]);
+
+    size_t k = 1;
+    while (k < max_clusters && sse[1] - sse[k] < 0.9 * (sse[1] - sse[max_clusters]))
+        k++;
+
+    std::vector<representative> reps;
+    for (size_t c = 0; c < centroids[k].size(); c++) {
+        size_t members = 0;
+        size_t closest = signatures.size();
+        for (size_t i = 0; i < signatures.size(); i++) {
+            if (clusters[k][i] != c)
+                continue;
+            members++;
+            if (closest == signatures.size()
+                || distance2(signatures[i], centroids[k][c]) < distance2(signatures[closest], centroids[k][c]))
+                closest = i;
+        }
+        if (members != 0)
+            reps.push_back({closest, double(members) / double(signatures.size())});
+    }
+    std::sort(reps.begin(), reps.end(), [](auto &a, auto &b) { return a.interval < b.interval; });
+    return reps;
+}
+
+/* Representative file, text:
+ *   interval <requests per interval> <total intervals>
+ *   simpoint <interval index> <weight>
+ *   ...
+ */
+static void write_file(const std::string &filename,
+                       size_t interval,
+                       size_t total_intervals,
+                       const std::vector<representative> &reps)
+{
+    std::ofstream file(filename);
+    if (!file.good())
+        throw std::runtime_error("cannot open simpoint file: " + filename);
+    file << "# Representative trace intervals, written by vans_simpoint\n";
+    file << "interval " << interval << " " << total_intervals << "\n";
+    for (auto &r : reps)
+        file << "simpoint " << r.interval << " " << r.weight << "\n";
+}
+
+static std::vector<representative> read_file(const std::string &filename, size_t &interval, size_t &total_intervals)
+{
+    std::ifstream file(filename);
+    if (!file.good())
+        throw std::runtime_error("cannot open simpoint file: " + filename);
+
+    std::vector<representative> reps;
+    interval = 0;
+    std::string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "interval") {
+            fields >> interval >> total_intervals;
+        } else if (kind == "simpoint") {
+            representative r{};
+            fields >> r.interval >> r.weight;
+            reps.push_back(r);
+        } else {
+            throw std::runtime_error("simpoint file " + filename + " format error: " + line);
+        }
+        if (fields.fail())
+            throw std::runtime_error("simpoint file " + filename + " format error: " + line);
+    }
+    if (interval == 0 || reps.empty())
+        throw std::runtime_error("simpoint file " + filename + " has no interval size or no simpoint.");
+    std::sort(reps.begin(), reps.end(), [](auto &a, auto &b) { return a.interval < b.interval; });
+    return reps;
+}
+
+} // namespace vans::simpoint
+
+#endif // VANS_SIMPOINT_H
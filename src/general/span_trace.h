@@ -0,0 +1,146 @@
+#ifndef VANS_SPAN_TRACE_H
+#define VANS_SPAN_TRACE_H
+
+#include "common.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vans
+{
+
+/* Span tracer: sampled request spans and state changes, written as Chrome trace-event JSON
+ *   Open the output in chrome://tracing or ui.perfetto.dev, each component is one track.
+ *   The first traced component samples a request by the 4 KiB page of its address (1 in `sample_pages`), and the
+ *   decision travels with the request and the requests it causes, so lower levels trace the same requests even where
+ *   they map the address elsewhere. Events go to a buffer of `max_events` allocated up front (the simulator runs on
+ *   one thread, so one buffer), later events are dropped and counted. The file is written when the tracer is freed.
+ */
+class span_tracer
+{
+  private:
+    enum class phase : uint8_t { span, instant };
+
+    struct event {
+        phase ph;
+        uint32_t track;
+        uint32_t name;
+        addr_t addr;
+        clk_t begin;
+        clk_t end;
+    };
+
+    std::ofstream file;
+    double tCK;
+    size_t sample_pages;
+    size_t max_events;
+    size_t dropped = 0;
+
+    std::vector<event> events;
+    std::vector<std::string> tracks;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> name_ids;
+
+    uint32_t name_id(const std::string &name)
+    {
+        auto it = name_ids.find(name);
+        if (it != name_ids.end())
+            return it->second;
+        names.push_back(name);
+        return name_ids[name] = uint32_t(names.size() - 1);
+    }
+
+    void record(phase ph, uint32_t track, const std::string &name, addr_t addr, clk_t begin, clk_t end)
+    {
+        if (events.size() == max_events) {
+            dropped++;
+            return;
+        }
+        events.push_back({ph, track, name_id(name), addr, begin, end});
+    }
+
+    std::string timestamp(clk_t clk) const
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.4f", double(clk) * tCK / 1000.0);
+        return buf;
+    }
+
+  public:
+    span_tracer()                    = delete;
+    span_tracer(const span_tracer &) = delete;
+    span_tracer &operator=(const span_tracer &) = delete;
+
+    span_tracer(const std::string &filename, double tCK, size_t sample_pages, size_t max_events) :
+        file(filename), tCK(tCK), sample_pages(sample_pages), max_events(max_events)
+    {
+        if (!file.good())
+            throw std::runtime_error("cannot open span trace file: " + filename);
+        if (sample_pages == 0)
+            throw std::runtime_error("span_trace_sample_pages should be larger than 0.");
+        events.reserve(max_events);
+    }
+
+    ~span_tracer()
+    {
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        for (size_t t = 0; t < tracks.size(); t++) {
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t << ",\"args\":{\"name\":\""
+                 << tracks[t] << "\"}},\n";
+        }
+        for (size_t i = 0; i < events.size(); i++) {
+            const auto &e = events[i];
+            std::string common = "\"name\":\"" + names[e.name] + "\",\"pid\":0,\"tid\":" + std::to_string(e.track);
+            char addr[32];
+            snprintf(addr, sizeof(addr), "0x%lx", e.addr);
+            std::string args = ",\"args\":{\"addr\":\"" + std::string(addr) + "\"}";
+            if (e.ph == phase::span) {
+                /* Spans of one track overlap, so they are async events paired by id */
+                std::string id = ",\"cat\":\"" + tracks[e.track] + "\",\"id\":" + std::to_string(i);
+                file << "{" << common << id << ",\"ph\":\"b\",\"ts\":" << timestamp(e.begin) << args << "},\n";
+                file << "{" << common << id << ",\"ph\":\"e\",\"ts\":" << timestamp(e.end) << "},\n";
+            } else {
+                file << "{" << common << ",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << timestamp(e.begin) << args << "},\n";
+            }
+        }
+        file << "{\"name\":\"dropped_events\",\"ph\":\"M\",\"pid\":0,\"args\":{\"count\":" << dropped << "}}\n";
+        file << "]}" << std::endl;
+    }
+
+    /* Register a track (one component), return its id */
+    uint32_t add_track(const std::string &name)
+    {
+        tracks.push_back(name);
+        return uint32_t(tracks.size() - 1);
+    }
+
+    /* Decide `sample` by the page of `addr` if no component above has, return whether it is sampled */
+    bool sampled(trace_sample &sample, addr_t addr) const
+    {
+        if (sample == trace_sample::undecided) {
+            uint64_t page = addr >> 12U;
+            bool hit      = ((page * 0x9e3779b97f4a7c15ULL) >> 32U) % sample_pages == 0;
+            sample        = hit ? trace_sample::sampled : trace_sample::unsampled;
+        }
+        return sample == trace_sample::sampled;
+    }
+
+    /* A request served from `begin` to `end` on `track` */
+    void span(uint32_t track, const std::string &name, addr_t addr, clk_t begin, clk_t end)
+    {
+        record(phase::span, track, name, addr, begin, end);
+    }
+
+    /* A state change or command at `clk` on `track` */
+    void instant(uint32_t track, const std::string &name, addr_t addr, clk_t clk)
+    {
+        record(phase::instant, track, name, addr, clk, clk);
+    }
+};
+
+} // namespace vans
+
+#endif // VANS_SPAN_TRACE_H
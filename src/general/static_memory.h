@@ -47,6 +47,17 @@ class static_media_controller : public media_controller<base_request, static_med
         return {false, false, clk_invalid};
     }
 
+    void reconfigure(const config &cfg) final
+    {
+        this->read_latency  = cfg.get_ulong("read_latency");
+        this->write_latency = cfg.get_ulong("write_latency");
+    }
+
+    [[nodiscard]] std::vector<std::string> reconfigure_keys(const config &cfg) const final
+    {
+        return {"read_latency", "write_latency"};
+    }
+
     void drain() final {}
 
     bool pending() final
@@ -0,0 +1,519 @@
+#ifndef VANS_SURROGATE_H
+#define VANS_SURROGATE_H
+
+#include "checkpoint.h"
+#include "component.h"
+#include "config.h"
+#include "controller.h"
+#include "static_memory.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace vans::surrogate
+{
+
+/* Request classes: the request type and the DIMM buffer level that holds the block */
+enum class request_class { read_rmw_hit, read_ait_hit, read_miss, write_rmw_hit, write_ait_hit, write_miss, total };
+
+static const char *const request_class_name[] = {
+    "read_rmw_hit",
+    "read_ait_hit",
+    "read_miss",
+    "write_rmw_hit",
+    "write_ait_hit",
+    "write_miss",
+};
+
+constexpr size_t total_classes = size_t(request_class::total);
+
+/* Functional LRU tags of a buffer with `entries` blocks */
+class lru_tags
+{
+  private:
+    size_t entries;
+    std::list<addr_t> order; /* Most recently used first */
+    std::unordered_map<addr_t, std::list<addr_t>::iterator> tags;
+
+  public:
+    lru_tags() = delete;
+
+    explicit lru_tags(size_t entries) : entries(entries) {}
+
+    /* Touch `block`, return true on a hit */
+    bool access(addr_t block)
+    {
+        auto it = tags.find(block);
+        if (it != tags.end()) {
+            order.splice(order.begin(), order, it->second);
+            return true;
+        }
+        order.push_front(block);
+        tags[block] = order.begin();
+        if (order.size() > entries) {
+            tags.erase(order.back());
+            order.pop_back();
+        }
+        return false;
+    }
+
+    /* Saved from the least to the most recently used block, a restore replays the accesses */
+    void serialize(checkpoint &ckpt)
+    {
+        std::vector<addr_t> blocks(order.rbegin(), order.rend());
+        ckpt.io(blocks);
+        if (ckpt.restoring()) {
+            order.clear();
+            tags.clear();
+            for (auto b : blocks)
+                access(b);
+        }
+    }
+};
+
+/* Queueing model of a DIMM: one server in front of a fixed read latency, both per request class
+ *   A request occupies the server for `service` clk after the requests before it, which is the inverse of the
+ *   saturated throughput of its class. A read completes `latency` clk after its service starts.
+ */
+struct model {
+    std::array<double, total_classes> service{};
+    std::array<double, total_classes> latency{};
+};
+
+/* One request of the detailed calibration run, `depart` is `clk_invalid` for writes */
+struct sample {
+    clk_t arrive;
+    clk_t depart;
+    request_class cls;
+};
+
+/* Requests of each class and busy clks of the detailed subtree in one calibration slice */
+struct slice {
+    std::array<size_t, total_classes> requests{};
+    clk_t busy = 0;
+};
+
+/* Service times from the slices: non-negative least squares of `busy = sum(requests * service)`
+ *   A ridge term pulls every class to the mean service time, so a class that is rare or always mixed in the same
+ *   proportion gets the mean instead of an arbitrary split.
+ */
+static std::array<double, total_classes> fit_service(const std::vector<slice> &slices)
+{
+    double total_busy     = 0;
+    double total_requests = 0;
+    std::array<double, total_classes> gram{};
+    for (auto &s : slices) {
+        total_busy += double(s.busy);
+        for (size_t c = 0; c < total_classes; c++) {
+            total_requests += double(s.requests[c]);
+            gram[c] += double(s.requests[c]) * double(s.requests[c]);
+        }
+    }
+    double mean = total_requests != 0 ? total_busy / total_requests : 0;
+    double ridge = 0;
+    for (auto g : gram)
+        ridge += g;
+    ridge = std::max(0.01 * ridge / double(total_classes), 1.0);
+
+    std::array<double, total_classes> service;
+    service.fill(mean);
+    for (int iter = 0; iter < 200; iter++) {
+        for (size_t c = 0; c < total_classes; c++) {
+            double num = ridge * mean;
+            for (auto &s : slices) {
+                if (s.requests[c] == 0)
+                    continue;
+                double rest = double(s.busy);
+                for (size_t d = 0; d < total_classes; d++) {
+                    if (d != c)
+                        rest -= double(s.requests[d]) * service[d];
+                }
+                num += double(s.requests[c]) * rest;
+            }
+            service[c] = std::max(0.0, num / (gram[c] + ridge));
+        }
+    }
+    return service;
+}
+
+/* Read latencies from the samples: replay the arrivals through the server and average the time from service start
+ *   to depart, a class without reads gets the average of all reads
+ */
+static std::array<double, total_classes> fit_latency(const std::vector<sample> &samples,
+                                                     const std::array<double, total_classes> &service)
+{
+    std::array<double, total_classes> sum{};
+    std::array<size_t, total_classes> cnt{};
+    double all_sum    = 0;
+    size_t all_cnt    = 0;
+    double busy_until = 0;
+    for (auto &s : samples) {
+        auto c       = size_t(s.cls);
+        double start = std::max(double(s.arrive), busy_until);
+        busy_until   = start + service[c];
+        if (s.depart == clk_invalid)
+            continue;
+        double latency = std::max(0.0, double(s.depart) - start);
+        sum[c] += latency;
+        cnt[c]++;
+        all_sum += latency;
+        all_cnt++;
+    }
+    std::array<double, total_classes> latency{};
+    for (size_t c = 0; c < total_classes; c++) {
+        if (cnt[c] != 0)
+            latency[c] = sum[c] / double(cnt[c]);
+        else if (all_cnt != 0)
+            latency[c] = all_sum / double(all_cnt);
+    }
+    return latency;
+}
+
+/* Calibration file, text:
+ *   class <name> <service clk> <latency clk>
+ *   ...
+ */
+static void write_model(const std::string &filename, const model &m)
+{
+    std::ofstream file(filename);
+    if (!file.good())
+        throw std::runtime_error("cannot open surrogate calibration file: " + filename);
+    file << "# Surrogate calibration, written by vans\n";
+    for (size_t c = 0; c < total_classes; c++)
+        file << "class " << request_class_name[c] << " " << m.service[c] << " " << m.latency[c] << "\n";
+}
+
+static model read_model(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file.good())
+        throw std::runtime_error("cannot open surrogate calibration file: " + filename);
+
+    model m;
+    std::array<bool, total_classes> found{};
+    std::string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string kind, name;
+        double service, latency;
+        fields >> kind >> name >> service >> latency;
+        auto c = std::find(std::begin(request_class_name), std::end(request_class_name), name)
+                 - std::begin(request_class_name);
+        if (fields.fail() || kind != "class" || size_t(c) == total_classes)
+            throw std::runtime_error("surrogate calibration file " + filename + " format error: " + line);
+        m.service[c] = service;
+        m.latency[c] = latency;
+        found[c]     = true;
+    }
+    for (size_t c = 0; c < total_classes; c++) {
+        if (!found[c])
+            throw std::runtime_error("surrogate calibration file " + filename + " has no class "
+                                     + request_class_name[c]);
+    }
+    return m;
+}
+
+/* Surrogate controller: serves the requests of the detailed subtree below it with `model`
+ *   The first `calibration_requests` requests go to the detailed subtree, their busy clks and read latencies
+ *   calibrate the model. Once the subtree drains, requests are served by the model and the subtree is no longer
+ *   ticked. With `calibration_requests : 0` the model is read from `calibration_file`.
+ *   Like the rmw buffer, writes complete silently and only take server time.
+ */
+class surrogate_controller : public memory_controller<base_request, static_memory>
+{
+  public:
+    enum class phase { calibrating, draining, analytic };
+
+    lru_tags rmw_tags;
+    lru_tags ait_tags;
+    size_t queue_entries;
+    size_t calibration_requests;
+    std::string calibration_file;
+
+    model params;
+    phase curr_phase = phase::analytic;
+    clk_t curr_clk   = 0;
+
+    /* Calibration */
+    size_t slice_requests = 1;
+    std::vector<sample> samples;
+    std::vector<slice> slices;
+
+    /* Service start clks of the queued requests, and completions of the reads */
+    std::deque<double> queued;
+    double busy_until = 0;
+    struct completion {
+        clk_t clk;
+        logic_addr_t addr;
+        base_callback_f callback;
+
+        bool operator>(const completion &other) const
+        {
+            return clk > other.clk;
+        }
+    };
+    std::priority_queue<completion, std::vector<completion>, std::greater<>> completions;
+
+    vans::counter cnt_events{"surrogate",
+                             "events",
+                             {
+                                 "read_access",
+                                 "write_access",
+                                 "read_rmw_hit",
+                                 "read_ait_hit",
+                                 "read_miss",
+                                 "write_rmw_hit",
+                                 "write_ait_hit",
+                                 "write_miss",
+                                 "calibration_access",
+                                 "queue_full",
+                             }};
+
+    surrogate_controller() = delete;
+
+    explicit surrogate_controller(const config &cfg) :
+        memory_controller(cfg),
+        rmw_tags(cfg.check("rmw_entries") ? cfg.get_ulong("rmw_entries") : 64),
+        ait_tags(cfg.check("ait_entries") ? cfg.get_ulong("ait_entries") : 4096),
+        queue_entries(cfg.check("queue_entries") ? cfg.get_ulong("queue_entries") : 64),
+        calibration_requests(cfg.check("calibration_requests") ? cfg.get_ulong("calibration_requests") : 20000),
+        calibration_file(cfg.check("calibration_file") ? cfg["calibration_file"] : "none")
+    {
+        if (queue_entries == 0)
+            throw std::runtime_error("[" + cfg.section_name + "] queue_entries should be larger than 0.");
+        if (calibration_requests != 0) {
+            start_calibration();
+        } else if (calibration_file != "none") {
+            params = read_model(calibration_file);
+        } else {
+            throw std::runtime_error("[" + cfg.section_name
+                                     + "] needs calibration_requests or a calibration_file to calibrate the model.");
+        }
+    }
+
+    /* The detailed subtree has work and is ticked */
+    [[nodiscard]] bool detailed() const
+    {
+        return curr_phase != phase::analytic;
+    }
+
+    request_class classify(const base_request &req)
+    {
+        /* Both levels see every access, as the rmw buffer fills from the ait buffer */
+        bool rmw_hit = rmw_tags.access(rmw::translate_to_block_addr(req.addr));
+        bool ait_hit = ait_tags.access(ait::translate_to_block_addr(req.addr));
+        size_t level = rmw_hit ? 0 : ait_hit ? 1 : 2;
+        return request_class(level + (req.type == base_request_type::write ? 3 : 0));
+    }
+
+    base_response issue_request(base_request &req) final
+    {
+        clk_t arrive = curr_clk + 1;
+        if (curr_phase == phase::calibrating) {
+            auto [next_addr, next] = this->get_next_level(req.addr);
+            auto index             = samples.size();
+            base_request next_req  = req;
+            next_req.addr          = next_addr;
+            next_req.callback      = [this, index, callback = req.callback](logic_addr_t addr, clk_t clk) {
+                this->samples[index].depart = clk;
+                if (callback)
+                    callback(addr, clk);
+            };
+            samples.push_back({arrive, clk_invalid, request_class::total});
+            auto res = next->issue_request(next_req);
+            if (!std::get<0>(res)) {
+                samples.pop_back();
+                return res;
+            }
+
+            auto cls = count(req);
+            cnt_events["calibration_access"]++;
+            if (index % slice_requests == 0)
+                slices.emplace_back();
+            slices.back().requests[size_t(cls)]++;
+            samples[index].cls = cls;
+            if (samples.size() == calibration_requests)
+                curr_phase = phase::draining;
+            return res;
+        }
+
+        if (this->full()) {
+            cnt_events["queue_full"]++;
+            return {false, false, clk_invalid};
+        }
+        auto c       = size_t(count(req));
+        double start = std::max(double(arrive), busy_until);
+        busy_until   = start + params.service[c];
+        queued.push_back(start);
+        if (req.type == base_request_type::read && req.callback)
+            completions.push({clk_t(start + params.latency[c]), req.addr, req.callback});
+        return {true, false, clk_invalid};
+    }
+
+    void warm(const base_request &req) final
+    {
+        classify(req);
+        if (curr_phase == phase::calibrating)
+            this->warm_next_level(req.type, req.addr, req.arrive);
+    }
+
+    /* A new sweep point recalibrates the model against the reconfigured subtree */
+    void reconfigure(const config &cfg) final
+    {
+        queue_entries = cfg.check("queue_entries") ? cfg.get_ulong("queue_entries") : 64;
+        if (calibration_requests != 0)
+            start_calibration();
+    }
+
+    [[nodiscard]] std::vector<std::string> reconfigure_keys(const config &cfg) const final
+    {
+        return {"queue_entries"};
+    }
+
+    void drain_current() final {}
+
+    void tick(clk_t clk) final
+    {
+        curr_clk = clk;
+        if (curr_phase != phase::analytic) {
+            bool busy = std::any_of(this->next_level_components.begin(),
+                                    this->next_level_components.end(),
+                                    [](auto &n) { return n->pending(); });
+            if (busy && !slices.empty())
+                slices.back().busy++;
+            if (!busy && curr_phase == phase::draining)
+                finish_calibration();
+            return;
+        }
+
+        while (!queued.empty() && queued.front() <= double(clk))
+            queued.pop_front();
+        while (!completions.empty() && completions.top().clk <= clk) {
+            auto c = completions.top();
+            completions.pop();
+            c.callback(c.addr, clk);
+        }
+    }
+
+    bool pending_current() final
+    {
+        return curr_phase == phase::draining || !queued.empty() || !completions.empty();
+    }
+
+    bool full() final
+    {
+        switch (curr_phase) {
+        case phase::calibrating:
+            return std::any_of(this->next_level_components.begin(),
+                               this->next_level_components.end(),
+                               [](auto &n) { return n->full(); });
+        case phase::draining:
+            return true;
+        default:
+            return queued.size() >= queue_entries;
+        }
+    }
+
+    void print_counters() final
+    {
+        this->cnt_events.print(this->counter_dumper);
+    }
+
+    void register_stats(stats_registry &stats, const std::string &component) final
+    {
+        stats.add_counter(component, this->cnt_events);
+        stats.add_gauge(component + ".queue", [this]() { return this->queued.size(); });
+    }
+
+    void serialize(checkpoint &ckpt) final
+    {
+        ckpt.expect_idle(queued.empty() && completions.empty(), "surrogate");
+        ckpt.io(rmw_tags);
+        ckpt.io(ait_tags);
+        ckpt.io(params);
+        ckpt.io(curr_phase);
+        ckpt.io(samples);
+        ckpt.io(slices);
+        ckpt.io(busy_until);
+        ckpt.io(cnt_events);
+    }
+
+  private:
+    request_class count(const base_request &req)
+    {
+        auto cls = classify(req);
+        cnt_events[req.type == base_request_type::read ? "read_access" : "write_access"]++;
+        cnt_events[request_class_name[size_t(cls)]]++;
+        return cls;
+    }
+
+    void start_calibration()
+    {
+        curr_phase     = phase::calibrating;
+        slice_requests = std::max(calibration_requests / 32, size_t(1));
+        samples.clear();
+        slices.clear();
+        samples.reserve(calibration_requests);
+    }
+
+    void finish_calibration()
+    {
+        params.service = fit_service(slices);
+        params.latency = fit_latency(samples, params.service);
+        samples.clear();
+        slices.clear();
+        busy_until = double(curr_clk);
+        curr_phase = phase::analytic;
+        if (calibration_file != "none")
+            write_model(calibration_file, params);
+    }
+};
+
+class surrogate : public component<surrogate_controller, static_memory>
+{
+  public:
+    surrogate() = delete;
+
+    explicit surrogate(const config &cfg) : component(cfg)
+    {
+        this->ctrl = std::make_shared<surrogate_controller>(cfg);
+    }
+
+    base_response issue_request(base_request &req) override
+    {
+        return this->issue_tracked_request(req);
+    }
+
+    /* The detailed subtree is only ticked while it calibrates the model */
+    void tick_next(clk_t curr_clk) override
+    {
+        if (this->ctrl->detailed())
+            base_component::tick_next(curr_clk);
+    }
+
+    /* An idle subtree has no periodic work once it no longer ticks */
+    clk_t next_event(clk_t curr_clk) override
+    {
+        return this->ctrl->detailed() ? component::next_event(curr_clk) : clk_t(clk_invalid);
+    }
+
+    /* The detailed subtree keeps its own stat dump */
+    void connect_dumper(std::shared_ptr<dumper> dumper) override
+    {
+        this->stat_dumper          = dumper;
+        this->ctrl->counter_dumper = dumper;
+    }
+};
+
+} // namespace vans::surrogate
+
+#endif // VANS_SURROGATE_H
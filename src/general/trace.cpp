@@ -1,6 +1,19 @@
 #include "trace.h"
+#include "request_queue.h"
+#include "simpoint.h"
 #include "utils.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
 
 namespace vans::trace
 {
@@ -8,6 +21,7 @@ namespace vans::trace
 bool trace::get_dram_trace_request(logic_addr_t &addr,
                                    base_request_type &type,
                                    bool &critical,
+                                   persist_op &persist,
                                    clk_t &idle_clk_injection)
 {
     std::string line;
@@ -21,6 +35,7 @@ bool trace::get_dram_trace_request(logic_addr_t &addr,
     size_t pos;
     addr     = std::stoul(line, &pos, 16);
     critical = false;
+    persist  = persist_op::none;
     pos      = line.find_first_not_of(' ', pos + 1);
 
     if (pos == std::string::npos || line.substr(pos)[0] == 'R') {
@@ -31,6 +46,16 @@ bool trace::get_dram_trace_request(logic_addr_t &addr,
     } else if (line.substr(pos)[0] == 'C') {
         type     = base_request_type::read;
         critical = true;
+    } else if (line.substr(pos)[0] == 'F') {
+        type    = base_request_type::write;
+        persist = persist_op::clwb;
+    } else if (line.substr(pos)[0] == 'N') {
+        type    = base_request_type::write;
+        persist = persist_op::ntstore;
+    } else if (line.substr(pos)[0] == 'S') {
+        persist = persist_op::sfence;
+    } else if (line.substr(pos)[0] == 'M') {
+        persist = persist_op::marker;
     } else
         throw std::runtime_error("Trace file format error.");
 
@@ -40,9 +65,34 @@ bool trace::get_dram_trace_request(logic_addr_t &addr,
     } else {
         idle_clk_injection = clk_invalid;
     }
+    records++;
     return true;
 }
 
+bool trace::skip(size_t count)
+{
+    logic_addr_t addr;
+    base_request_type type;
+    bool critical;
+    persist_op persist;
+    clk_t idle_clk_injection;
+    while (records < count) {
+        if (!get_dram_trace_request(addr, type, critical, persist, idle_clk_injection))
+            return false;
+    }
+    return true;
+}
+
+/* Print end-to-end latency histograms (in clk) to the console */
+static void print_latency_histograms(const std::vector<const histogram *> &hists)
+{
+    auto cli = std::make_shared<dumper>(dumper::type::cli, "cli", "");
+    for (auto hist : hists) {
+        if (hist->count() != 0)
+            hist->print(cli);
+    }
+}
+
 void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model)
 {
     trace trace(trace_filename);
@@ -56,9 +106,45 @@ void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<ba
     clk_t idle_clk_injection = clk_invalid;
     double tCK               = std::stod(cfg["basic"]["tCK"]);
 
+    /* Persistence: clwb/ntstore are posted to the flush buffer, sfence waits until they reach the persistence domain.
+     *   adr : writes persist once the imc accepts them into its wpq
+     *   eadr: CPU caches are also persistent, sfence does not wait for any write
+     */
+    persist_op persist          = persist_op::none;
+    bool fence_stall            = false;
+    clk_t fence_start_clk       = 0;
+    std::string persist_domain  = cfg["trace"].check("persist_domain") ? cfg["trace"]["persist_domain"] : "adr";
+    size_t flush_buffer_entries =
+        cfg["trace"].check("flush_buffer_entries") ? cfg["trace"].get_ulong("flush_buffer_entries") : 16;
+    if (persist_domain != "adr" && persist_domain != "eadr")
+        throw std::runtime_error("Unknown persist_domain [" + persist_domain + "], should be adr or eadr.");
+    bool eadr = persist_domain == "eadr";
+    base_request_queue flush_buffer(flush_buffer_entries);
+
+    /* Persist latency of each fence, from the sfence to the persistence domain */
+    histogram hist_persist_latency("trace", "persist_latency");
+
+    auto tick_persist = [&](clk_t curr_clk) {
+        if (!flush_buffer.empty()) {
+            /* Issue a copy, the model may rewrite the address of a request it refuses */
+            auto req                               = flush_buffer.queue.front();
+            auto [issued, deterministic, next_clk] = model->issue_request(req);
+            if (issued)
+                flush_buffer.queue.pop_front();
+        }
+        if (fence_stall && (eadr || flush_buffer.empty())) {
+            hist_persist_latency.record(curr_clk - fence_start_clk);
+            fence_stall = false;
+        }
+    };
+
     counter cnt_events("vans", "run_trace", {"write_access", "read_access", "total"});
     size_t tail_latency_cnt = 0;
 
+    /* End-to-end latency of each request, from its issue to its callback */
+    histogram hist_read_latency("trace", "read_latency");
+    histogram hist_write_latency("trace", "write_latency");
+
     auto critical_read_callback = [&critical_stall](logic_addr_t logic_addr, clk_t curr_clk) {
         critical_stall = false;
     };
@@ -81,28 +167,123 @@ void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<ba
     base_request_type type = base_request_type::read;
     base_request req(type, addr, curr_clk, callback);
 
+    /* Checkpoint: the model, plus the frontend state that the final report covers */
+    auto &trace_cfg      = cfg["trace"];
+    auto checkpoint_file = [&trace_cfg](const std::string &key) {
+        return trace_cfg.check(key) ? trace_cfg[key] : std::string("none");
+    };
+    auto config_ulong = [&trace_cfg](const std::string &key) {
+        return trace_cfg.check(key) ? trace_cfg.get_ulong(key) : 0;
+    };
+    std::string save_file    = checkpoint_file("checkpoint_save");
+    std::string restore_file = checkpoint_file("checkpoint_restore");
+    size_t save_at_request   = config_ulong("checkpoint_at_request");
+    clk_t save_at_clk        = config_ulong("checkpoint_at_clk");
+    bool save_pending        = save_file != "none";
+    if (save_pending && save_at_request == 0 && save_at_clk == 0)
+        throw std::runtime_error("[trace] checkpoint_save needs a checkpoint_at_request or checkpoint_at_clk.");
+
+    auto serialize = [&](checkpoint &ckpt, size_t &trace_offset) {
+        ckpt.io(curr_clk);
+        ckpt.io(trace_offset);
+        ckpt.io(cnt_events);
+        ckpt.io(hist_read_latency);
+        ckpt.io(hist_write_latency);
+        ckpt.io(tail_latency_cnt);
+        ckpt.io(hist_persist_latency);
+        model->serialize(ckpt);
+    };
+
+    if (restore_file != "none") {
+        checkpoint ckpt(restore_file, checkpoint::mode::restore);
+        size_t trace_offset = 0;
+        serialize(ckpt, trace_offset);
+        if (config_ulong("checkpoint_skip_trace") != 0 && !trace.skip(trace_offset)) {
+            throw std::runtime_error("Trace is shorter than the offset " + std::to_string(trace_offset)
+                                     + " of checkpoint " + restore_file);
+        }
+        std::cout << "Restored checkpoint " << restore_file << " at clock " << curr_clk << ", trace offset "
+                  << trace_offset << std::endl;
+    }
+
+    /* Fast-forward: requests only warm the model, one clk each so LRU state keeps their order */
+    std::string fast_forward = trace_cfg.check("fast_forward") ? trace_cfg["fast_forward"] : "0";
+    bool until_marker        = fast_forward == "marker";
+    size_t fast_forward_cnt  = until_marker ? 0 : std::stoul(fast_forward);
+    if (until_marker || trace.records < fast_forward_cnt) {
+        auto warm_start = std::chrono::high_resolution_clock::now();
+        size_t warmed   = 0;
+        while (until_marker || trace.records < fast_forward_cnt) {
+            trace_end = !trace.get_dram_trace_request(addr, type, critical_load, persist, idle_clk_injection);
+            if (trace_end || (until_marker && persist == persist_op::marker))
+                break;
+            if (persist == persist_op::sfence || persist == persist_op::marker)
+                continue;
+            model->warm(base_request(type, addr, curr_clk));
+            warmed++;
+            curr_clk++;
+        }
+        auto warm_end = std::chrono::high_resolution_clock::now();
+        auto warm_ms  = std::chrono::duration_cast<std::chrono::milliseconds>(warm_end - warm_start).count();
+        std::cout << "Fast-forward: " << warmed << " requests in " << warm_ms << " ms, detailed simulation starts at "
+                  << "clock " << curr_clk << ", trace offset " << trace.records << std::endl;
+    }
+    clk_t detailed_start_clk = curr_clk;
+
     auto sim_start = std::chrono::high_resolution_clock::now();
 
     while (!trace_end) {
+        if (save_pending && !wait_idle_clk && !stall
+            && ((save_at_request != 0 && trace.records >= save_at_request)
+                || (save_at_clk != 0 && curr_clk >= save_at_clk))) {
+            /* Finish every issued request, callbacks are not part of a checkpoint */
+            while (!flush_buffer.empty() || fence_stall || model->pending()) {
+                tick_persist(curr_clk);
+                model->tick(curr_clk);
+                curr_clk++;
+            }
+            checkpoint ckpt(save_file, checkpoint::mode::save);
+            size_t trace_offset = trace.records;
+            serialize(ckpt, trace_offset);
+            save_pending = false;
+            std::cout << "Saved checkpoint " << save_file << " at clock " << curr_clk << ", trace offset "
+                      << trace_offset << std::endl;
+        }
+
         if (!wait_idle_clk) {
-            if (!trace_end && !stall && !critical_stall) {
-                trace_end = !trace.get_dram_trace_request(addr, type, critical_load, idle_clk_injection);
+            if (!trace_end && !stall && !critical_stall && !fence_stall) {
+                do {
+                    trace_end =
+                        !trace.get_dram_trace_request(addr, type, critical_load, persist, idle_clk_injection);
+                } while (!trace_end && persist == persist_op::marker);
                 if (idle_clk_injection != clk_invalid)
                     wait_idle_clk = true;
+                if (!trace_end && persist == persist_op::sfence) {
+                    fence_stall     = true;
+                    fence_start_clk = curr_clk;
+                }
+                if (!trace_end)
+                    req.callback = critical_load ? critical_read_callback : callback;
             }
 
             if (!trace_end) {
-                req.addr = addr;
-                req.type = type;
-                if (critical_load) {
-                    req.callback = critical_read_callback;
-                } else {
-                    req.callback = callback;
-                }
+                req.addr   = addr;
+                req.type   = type;
+                req.arrive = curr_clk;
 
-                if (!critical_stall) {
-                    auto [issued, deterministic, next_clk] = model->issue_request(req);
-                    stall                                  = !issued;
+                if (!critical_stall && !fence_stall) {
+                    /* End-to-end latency, recorded with the latency at each component */
+                    auto &hist   = type == base_request_type::read ? hist_read_latency : hist_write_latency;
+                    bool tracked = tracked_callback::push_level(req, hist, curr_clk, nullptr, 0);
+                    bool issued  = false;
+                    if (persist == persist_op::none) {
+                        issued = std::get<0>(model->issue_request(req));
+                    } else {
+                        issued = flush_buffer.enqueue(req);
+                    }
+                    if (tracked && !issued)
+                        tracked_callback::pop_level(req);
+                    stall = !issued;
                     if (issued) {
                         if (type == base_request_type::read) {
                             cnt_events["read_access"]++;
@@ -134,6 +315,7 @@ void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<ba
             }
         }
 
+        tick_persist(curr_clk);
         model->tick(curr_clk);
         curr_clk++;
 
@@ -142,6 +324,12 @@ void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<ba
         }
     }
 
+    while (!flush_buffer.empty()) {
+        tick_persist(curr_clk);
+        model->tick(curr_clk);
+        curr_clk++;
+    }
+
     model->drain();
 
     while (model->pending()) {
@@ -161,6 +349,807 @@ void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<ba
     std::cout << "Last command clock: " << last_trace_clk << std::endl;
     std::cout << "Total ns: " << std::fixed << double(curr_clk) * tCK << std::endl;
     std::cout << "Last command ns: " << std::fixed << double(last_trace_clk) * tCK << std::endl;
+    if (detailed_start_clk != 0)
+        std::cout << "Detailed start clock: " << detailed_start_clk << std::endl;
+    if (hist_persist_latency.count() != 0)
+        std::cout << "Persist domain: " << persist_domain << std::endl;
+    print_latency_histograms({&hist_read_latency, &hist_write_latency, &hist_persist_latency});
+    std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
+}
+
+/* Replay of trace windows for the sampled frontends: functional warming, skipping, and detailed windows
+ *   Fences and markers are not requests here, clwb/ntstore are plain writes. A detailed window finishes every request
+ *   it issued before returning, so functional warming never sees requests in flight.
+ */
+class window_replay
+{
+  public:
+    struct window_stats {
+        size_t requests = 0;
+        size_t reads    = 0;
+        size_t writes   = 0;
+        clk_t read_sum  = 0;
+        clk_t write_sum = 0;
+        clk_t first_clk = clk_invalid;
+        clk_t last_clk  = 0;
+
+        /* Issue rate between the first and the last request, in GB/s */
+        [[nodiscard]] double bandwidth(double tCK) const
+        {
+            return double(requests * 64) / (double(last_clk - first_clk + 1) * tCK);
+        }
+
+        [[nodiscard]] double read_latency(double tCK) const
+        {
+            return reads != 0 ? double(read_sum) / double(reads) * tCK : 0;
+        }
+
+        [[nodiscard]] double write_latency(double tCK) const
+        {
+            return writes != 0 ? double(write_sum) / double(writes) * tCK : 0;
+        }
+    };
+
+    clk_t curr_clk  = 0;
+    bool trace_end  = false;
+    size_t requests = 0; /* Requests read so far, fences and markers excluded */
+    size_t warmed   = 0;
+
+    /* End-to-end latency of measured requests, from its issue to its callback */
+    histogram hist_read_latency{"trace", "read_latency"};
+    histogram hist_write_latency{"trace", "write_latency"};
+
+  private:
+    trace trace_file;
+    std::shared_ptr<base_component> model;
+    logic_addr_t addr        = 0;
+    base_request_type type   = base_request_type::read;
+    bool critical_load       = false;
+    persist_op persist       = persist_op::none;
+    clk_t idle_clk_injection = clk_invalid;
+    bool critical_stall      = false;
+
+    bool next_request()
+    {
+        do {
+            trace_end = !trace_file.get_dram_trace_request(addr, type, critical_load, persist, idle_clk_injection);
+        } while (!trace_end && (persist == persist_op::sfence || persist == persist_op::marker));
+        if (!trace_end)
+            requests++;
+        return !trace_end;
+    }
+
+  public:
+    window_replay(const std::string &trace_filename, std::shared_ptr<base_component> model) :
+        trace_file(trace_filename), model(std::move(model))
+    {
+    }
+
+    /* Warm the model with the next `count` requests, one clk each, return false at the end of the trace */
+    bool warm(size_t count)
+    {
+        for (size_t i = 0; i < count; i++) {
+            if (!next_request())
+                return false;
+            model->warm(base_request(type, addr, curr_clk));
+            warmed++;
+            curr_clk++;
+        }
+        return true;
+    }
+
+    /* Read past the next `count` requests, the model does not see them */
+    bool skip(size_t count)
+    {
+        for (size_t i = 0; i < count; i++) {
+            if (!next_request())
+                return false;
+        }
+        return true;
+    }
+
+    /* Simulate up to `count` requests in detail, `stats` is null for a detailed warm-up */
+    void simulate(size_t count, window_stats *stats)
+    {
+        size_t issued    = 0;
+        bool has_request = false;
+        clk_t idle_until = 0;
+        while (issued < count) {
+            if (!has_request)
+                has_request = next_request();
+            if (!has_request)
+                break;
+            if (!critical_stall && curr_clk >= idle_until) {
+                base_request req(type, addr, curr_clk);
+                bool critical = critical_load;
+                req.callback  = [this, stats, critical, read = type == base_request_type::read, arrive = curr_clk](
+                                   logic_addr_t logic_addr, clk_t clk) {
+                    clk_t latency = clk > arrive ? clk - arrive : 0;
+                    if (critical)
+                        critical_stall = false;
+                    if (stats == nullptr)
+                        return;
+                    (read ? hist_read_latency : hist_write_latency).record(latency);
+                    (read ? stats->read_sum : stats->write_sum) += latency;
+                    (read ? stats->reads : stats->writes)++;
+                };
+                if (std::get<0>(model->issue_request(req))) {
+                    if (stats != nullptr) {
+                        stats->requests++;
+                        stats->first_clk = std::min(stats->first_clk, curr_clk);
+                        stats->last_clk  = curr_clk;
+                    }
+                    critical_stall = critical;
+                    has_request    = false;
+                    issued++;
+                    if (idle_clk_injection != clk_invalid)
+                        idle_until = curr_clk + idle_clk_injection + 1;
+                }
+            }
+            model->tick(curr_clk);
+            curr_clk++;
+        }
+        while (model->pending()) {
+            model->tick(curr_clk);
+            curr_clk++;
+        }
+        critical_stall = false;
+    }
+
+    [[nodiscard]] std::streampos position()
+    {
+        return trace_file.tell();
+    }
+
+    void reopen(std::streampos pos)
+    {
+        trace_file.reopen(pos);
+    }
+
+    /* End of the trace: write back dirty buffers */
+    void finish()
+    {
+        model->drain();
+        while (model->pending()) {
+            model->tick(curr_clk);
+            curr_clk++;
+        }
+    }
+};
+
+/* Per-window CSV of the sampled frontends, `[dump] sample_dump` */
+static std::ofstream open_sample_dump(root_config &cfg, const std::string &header)
+{
+    auto &dump_cfg       = cfg["dump"];
+    std::string name     = dump_cfg.check("sample_dump") ? dump_cfg["sample_dump"] : "samples.csv";
+    std::string filename = dump_cfg["path"] + "/" + name;
+    std::ofstream file(filename);
+    if (!file.good())
+        throw std::runtime_error("cannot open sample dump file: " + filename);
+    file << header << "\n";
+    return file;
+}
+
+/* Mean and 95% confidence interval of per-window samples, returns the windows needed for `target_error`
+ *   n = (z * s / (mean * target_error))^2, with the sample standard deviation s and z = 1.96
+ */
+static size_t print_sample_summary(const std::string &name, const std::vector<double> &samples, double target_error)
+{
+    constexpr double z = 1.96;
+    if (samples.empty())
+        return 0;
+
+    double n    = double(samples.size());
+    double mean = 0;
+    for (auto v : samples)
+        mean += v;
+    mean /= n;
+    double var = 0;
+    for (auto v : samples)
+        var += (v - mean) * (v - mean);
+    double stddev     = samples.size() > 1 ? std::sqrt(var / (n - 1)) : 0;
+    double half_width = z * stddev / std::sqrt(n);
+    double rel_error  = mean != 0 ? half_width / mean : 0;
+    double cv         = mean != 0 ? stddev / mean : 0;
+    auto needed       = size_t(std::ceil(std::pow(z * cv / target_error, 2)));
+
+    std::cout << "Sampled " << name << ": mean " << std::fixed << mean << ", 95% CI +-" << half_width << " ("
+              << rel_error * 100 << "%), windows for +-" << target_error * 100 << "%: " << needed << std::endl;
+    return needed;
+}
+
+void run_sampled_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model)
+{
+    auto &trace_cfg     = cfg["trace"];
+    size_t period       = trace_cfg.get_ulong("sample_period");
+    size_t window       = trace_cfg.check("sample_window") ? trace_cfg.get_ulong("sample_window") : 1000;
+    size_t warmup       = trace_cfg.check("sample_warmup") ? trace_cfg.get_ulong("sample_warmup") : 1000;
+    double target_error = trace_cfg.check("sample_target_error") ? std::stod(trace_cfg["sample_target_error"]) : 0.05;
+    double tCK          = std::stod(cfg["basic"]["tCK"]);
+    if (window == 0 || warmup + window > period)
+        throw std::runtime_error("[trace] sampling needs 0 < sample_warmup + sample_window <= sample_period.");
+    if (target_error <= 0)
+        throw std::runtime_error("[trace] sample_target_error should be positive.");
+
+    auto samples_file = open_sample_dump(
+        cfg, "window,trace_offset,start_clk,requests,bandwidth_gbps,read_latency_ns,write_latency_ns");
+
+    window_replay replay(trace_filename, model);
+    std::vector<double> bandwidth, read_latency, write_latency;
+    auto sim_start = std::chrono::high_resolution_clock::now();
+
+    while (replay.warm(period - warmup - window)) {
+        replay.simulate(warmup, nullptr);
+        window_replay::window_stats stats;
+        size_t trace_offset = replay.requests;
+        replay.simulate(window, &stats);
+        /* A window cut short by the end of the trace is not a full sample */
+        if (stats.requests < window)
+            break;
+
+        bandwidth.push_back(stats.bandwidth(tCK));
+        if (stats.reads != 0)
+            read_latency.push_back(stats.read_latency(tCK));
+        if (stats.writes != 0)
+            write_latency.push_back(stats.write_latency(tCK));
+        samples_file << bandwidth.size() - 1 << "," << trace_offset << "," << stats.first_clk << "," << stats.requests
+                     << "," << stats.bandwidth(tCK) << "," << stats.read_latency(tCK) << ","
+                     << stats.write_latency(tCK) << "\n";
+    }
+
+    auto sim_end      = std::chrono::high_resolution_clock::now();
+    auto sim_duration = std::chrono::duration_cast<std::chrono::seconds>(sim_end - sim_start).count();
+
+    model->print_counters();
+
+    std::cout << "Total clock: " << replay.curr_clk << std::endl;
+    std::cout << "Sampled windows: " << bandwidth.size() << " (period " << period << ", warm-up " << warmup
+              << ", window " << window << " requests), functionally warmed requests: " << replay.warmed << std::endl;
+    print_latency_histograms({&replay.hist_read_latency, &replay.hist_write_latency});
+    size_t needed = 0;
+    needed        = std::max(needed, print_sample_summary("bandwidth GB/s", bandwidth, target_error));
+    needed        = std::max(needed, print_sample_summary("read latency ns", read_latency, target_error));
+    needed        = std::max(needed, print_sample_summary("write latency ns", write_latency, target_error));
+    if (needed > bandwidth.size())
+        std::cout << "Recommended windows: " << needed << ", sample_period " << replay.requests / needed
+                  << " for this trace" << std::endl;
+    else
+        std::cout << "Recommended windows: " << needed << ", the target error is met" << std::endl;
+    std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
+}
+
+void run_simpoint_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model)
+{
+    auto &trace_cfg = cfg["trace"];
+    size_t warmup   = trace_cfg.check("simpoint_warmup") ? trace_cfg.get_ulong("simpoint_warmup") : 0;
+    double tCK      = std::stod(cfg["basic"]["tCK"]);
+    if (trace_cfg.check("sample_period") && trace_cfg.get_ulong("sample_period") != 0)
+        throw std::runtime_error("[trace] simpoint_file and sample_period cannot be used together.");
+
+    size_t interval        = 0;
+    size_t total_intervals = 0;
+    auto reps              = simpoint::read_file(trace_cfg["simpoint_file"], interval, total_intervals);
+
+    auto samples_file = open_sample_dump(
+        cfg, "interval,weight,trace_offset,start_clk,requests,bandwidth_gbps,read_latency_ns,write_latency_ns");
+
+    window_replay replay(trace_filename, model);
+    double bandwidth = 0, read_latency = 0, read_weight = 0, write_latency = 0, write_weight = 0, clks = 0;
+    auto sim_start = std::chrono::high_resolution_clock::now();
+
+    for (auto &r : reps) {
+        size_t start = r.interval * interval;
+        if (warmup != 0 && start > replay.requests + warmup)
+            replay.skip(start - warmup - replay.requests);
+        if (start > replay.requests)
+            replay.warm(start - replay.requests);
+
+        window_replay::window_stats stats;
+        replay.simulate(interval, &stats);
+        if (stats.requests == 0)
+            throw std::runtime_error("simpoint interval " + std::to_string(r.interval) + " is beyond the trace end.");
+
+        bandwidth += r.weight * stats.bandwidth(tCK);
+        clks += r.weight * double(stats.last_clk - stats.first_clk + 1);
+        if (stats.reads != 0) {
+            read_latency += r.weight * stats.read_latency(tCK);
+            read_weight += r.weight;
+        }
+        if (stats.writes != 0) {
+            write_latency += r.weight * stats.write_latency(tCK);
+            write_weight += r.weight;
+        }
+        samples_file << r.interval << "," << r.weight << "," << start << "," << stats.first_clk << ","
+                     << stats.requests << "," << stats.bandwidth(tCK) << "," << stats.read_latency(tCK) << ","
+                     << stats.write_latency(tCK) << "\n";
+    }
+
+    auto sim_end      = std::chrono::high_resolution_clock::now();
+    auto sim_duration = std::chrono::duration_cast<std::chrono::seconds>(sim_end - sim_start).count();
+
+    model->print_counters();
+
+    std::cout << "Total clock: " << replay.curr_clk << std::endl;
+    std::cout << "Simulated intervals: " << reps.size() << " of " << total_intervals << " (interval " << interval
+              << " requests), functionally warmed requests: " << replay.warmed << std::endl;
+    print_latency_histograms({&replay.hist_read_latency, &replay.hist_write_latency});
+    std::cout << "Weighted bandwidth GB/s: " << std::fixed << bandwidth << std::endl;
+    if (read_weight != 0)
+        std::cout << "Weighted read latency ns: " << read_latency / read_weight << std::endl;
+    if (write_weight != 0)
+        std::cout << "Weighted write latency ns: " << write_latency / write_weight << std::endl;
+    std::cout << "Estimated trace clock: " << size_t(clks * double(total_intervals)) << std::endl;
+    std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
+}
+
+void run_parallel_trace(root_config &cfg,
+                        std::string &trace_filename,
+                        std::shared_ptr<base_component> model,
+                        const model_factory_f &make_model)
+{
+    auto &trace_cfg = cfg["trace"];
+    size_t segments = trace_cfg.get_ulong("parallel_segments");
+    size_t overlap  = trace_cfg.check("parallel_overlap") ? trace_cfg.get_ulong("parallel_overlap") : 100000;
+    size_t threads  = trace_cfg.check("parallel_threads") ? trace_cfg.get_ulong("parallel_threads") : 0;
+    double tCK      = std::stod(cfg["basic"]["tCK"]);
+    for (const auto &key : {"checkpoint_save", "checkpoint_restore"}) {
+        if (trace_cfg.check(key) && trace_cfg[key] != "none")
+            throw std::runtime_error(std::string("[trace] ") + key + " is not supported with parallel_segments.");
+    }
+    if (trace_cfg.check("fast_forward") && trace_cfg["fast_forward"] != "0")
+        throw std::runtime_error("[trace] fast_forward is not supported with parallel_segments.");
+    if (threads == 0)
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    threads = std::min(threads, segments);
+
+    /* Segment boundaries split the requests evenly */
+    window_replay scan(trace_filename, nullptr);
+    scan.skip(std::numeric_limits<size_t>::max());
+    size_t total_requests = scan.requests;
+    size_t segment_size   = (total_requests + segments - 1) / segments;
+
+    /* Trees of later segments only count, dumps come from the first segment */
+    root_config segment_cfg = cfg;
+    auto &dump_cfg          = segment_cfg["dump"].cfg;
+    dump_cfg["type"]        = "none";
+    for (const auto &key : {"span_trace", "dram_trace_dump", "pmem_trace_dump"})
+        dump_cfg[key] = "none";
+    dump_cfg["stats_epoch"] = "0";
+
+    struct segment {
+        std::shared_ptr<base_component> model;
+        std::unique_ptr<window_replay> replay;
+        window_replay::window_stats stats;
+        size_t begin    = 0;
+        size_t end      = 0;
+        clk_t start_clk = 0;
+        std::exception_ptr error;
+    };
+    std::vector<segment> segs(segments);
+    for (size_t i = 0; i < segments; i++) {
+        segs[i].begin = std::min(i * segment_size, total_requests);
+        segs[i].end   = std::min(segs[i].begin + segment_size, total_requests);
+        segs[i].model = i == 0 ? model : make_model(segment_cfg);
+    }
+
+    auto sim_start = std::chrono::high_resolution_clock::now();
+
+    std::atomic<size_t> next_segment{0};
+    auto worker = [&]() {
+        for (size_t i = next_segment++; i < segments; i = next_segment++) {
+            auto &seg = segs[i];
+            try {
+                seg.replay     = std::make_unique<window_replay>(trace_filename, seg.model);
+                size_t warm_at = seg.begin > overlap ? seg.begin - overlap : 0;
+                seg.replay->skip(warm_at);
+                seg.replay->warm(seg.begin - warm_at);
+                seg.start_clk = seg.replay->curr_clk;
+                seg.replay->simulate(seg.end - seg.begin, &seg.stats);
+                if (i == segments - 1)
+                    seg.replay->finish();
+            } catch (...) {
+                seg.error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+        t.join();
+    for (auto &seg : segs) {
+        if (seg.error)
+            std::rethrow_exception(seg.error);
+    }
+
+    /* Stitch: counters and histograms add up, segments follow each other in time */
+    stats_registry total_stats;
+    model->register_stats(total_stats);
+    clk_t total_clk = 0;
+    size_t warmed   = 0;
+    for (size_t i = 0; i < segments; i++) {
+        auto &seg = segs[i];
+        if (i != 0) {
+            stats_registry seg_stats;
+            seg.model->register_stats(seg_stats);
+            total_stats.merge(seg_stats);
+            segs[0].replay->hist_read_latency.merge(seg.replay->hist_read_latency);
+            segs[0].replay->hist_write_latency.merge(seg.replay->hist_write_latency);
+        }
+        total_clk += seg.replay->curr_clk - seg.start_clk;
+        warmed += seg.replay->warmed;
+    }
+
+    auto sim_end      = std::chrono::high_resolution_clock::now();
+    auto sim_duration = std::chrono::duration_cast<std::chrono::seconds>(sim_end - sim_start).count();
+
+    model->print_counters();
+
+    std::cout << "Total clock: " << total_clk << std::endl;
+    std::cout << "Total ns: " << std::fixed << double(total_clk) * tCK << std::endl;
+    std::cout << "Parallel segments: " << segments << " on " << threads << " threads, overlap " << overlap
+              << " requests, functionally warmed requests: " << warmed << std::endl;
+    for (size_t i = 0; i < segments; i++) {
+        std::cout << "Segment " << i << ": requests [" << segs[i].begin << ", " << segs[i].end << "), clock "
+                  << segs[i].replay->curr_clk - segs[i].start_clk << std::endl;
+    }
+    print_latency_histograms({&segs[0].replay->hist_read_latency, &segs[0].replay->hist_write_latency});
+    std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
+}
+
+void run_sweep_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model)
+{
+    auto &trace_cfg = cfg["trace"];
+    auto &dump_cfg  = cfg["dump"];
+    size_t prefix   = trace_cfg.check("sweep_prefix") ? trace_cfg.get_ulong("sweep_prefix") : 0;
+    size_t jobs     = trace_cfg.check("sweep_jobs") ? trace_cfg.get_ulong("sweep_jobs") : 0;
+    double tCK      = std::stod(cfg["basic"]["tCK"]);
+    if (jobs == 0)
+        jobs = std::max(1U, std::thread::hardware_concurrency());
+    /* Children share the parent's buffered writers and epoch stats file, and never flush them */
+    for (const auto &key : {"span_trace", "dram_trace_dump", "pmem_trace_dump"}) {
+        if (dump_cfg.check(key) && dump_cfg[key] != "none")
+            throw std::runtime_error(std::string("[dump] ") + key + " is not supported with a sweep.");
+    }
+    if (dump_cfg.check("stats_epoch") && dump_cfg.get_ulong("stats_epoch") != 0)
+        throw std::runtime_error("[dump] stats_epoch is not supported with a sweep.");
+
+    /* `section.key=v1,v2,...;section.key=...`, every combination of the values is one point */
+    struct dimension {
+        std::string section;
+        std::string key;
+        std::vector<std::string> values;
+    };
+    std::vector<dimension> dims;
+    size_t points = 1;
+    for (const auto &spec : split_mapping_args(trace_cfg["sweep"], ';')) {
+        auto eq  = spec.find('=');
+        auto dot = spec.rfind('.', eq);
+        if (eq == std::string::npos || dot == std::string::npos)
+            throw std::runtime_error("[trace] sweep format error: " + spec + ", should be section.key=v1,v2,...");
+        dimension dim{
+            spec.substr(0, dot), spec.substr(dot + 1, eq - dot - 1), split_mapping_args(spec.substr(eq + 1), ',')};
+        if (cfg.cfg.count(dim.section) == 0 || !cfg[dim.section].check(dim.key) || dim.values.empty())
+            throw std::runtime_error("[trace] sweep has no setting [" + dim.section + "] " + dim.key + " or no value.");
+        points *= dim.values.size();
+        dims.push_back(std::move(dim));
+    }
+
+    /* Sizes and policies are fixed once the model is built, a point may only vary what `reconfigure` re-reads */
+    std::set<std::string> reconfigurable;
+    model->reconfigure_keys(cfg, reconfigurable);
+    for (auto &dim : dims) {
+        if (reconfigurable.count(dim.section + "." + dim.key) == 0)
+            throw std::runtime_error("[trace] sweep cannot vary [" + dim.section + "] " + dim.key
+                                     + ", it is not re-read when the model is reconfigured.");
+    }
+
+    auto point_label = [&](size_t point) {
+        std::string label;
+        for (auto &dim : dims) {
+            label += label.empty() ? "" : " ";
+            label += dim.section + "." + dim.key + "=" + dim.values[point % dim.values.size()];
+            point /= dim.values.size();
+        }
+        return label;
+    };
+
+    auto sim_start = std::chrono::high_resolution_clock::now();
+
+    window_replay replay(trace_filename, model);
+    replay.simulate(prefix, nullptr);
+    clk_t prefix_clk       = replay.curr_clk;
+    std::streampos tail_at = replay.position();
+    std::cout << "Sweep prefix: " << replay.requests << " requests, clock " << prefix_clk << std::endl;
+    std::cout.flush();
+
+    /* Each point runs the tail in a forked child, from the copy-on-write state of the prefix */
+    std::vector<std::string> results(points);
+    std::map<pid_t, std::pair<size_t, int>> running;
+    auto collect = [&]() {
+        int status = 0;
+        pid_t pid  = waitpid(-1, &status, 0);
+        if (pid < 0)
+            throw std::runtime_error(std::string("sweep waitpid failed: ") + strerror(errno));
+        auto [point, fd] = running.at(pid);
+        running.erase(pid);
+        char buf[256];
+        ssize_t len;
+        while ((len = read(fd, buf, sizeof(buf))) > 0)
+            results[point].append(buf, size_t(len));
+        close(fd);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            throw std::runtime_error("sweep point [" + point_label(point) + "] failed: " + results[point]);
+    };
+
+    for (size_t point = 0; point < points; point++) {
+        if (running.size() >= jobs)
+            collect();
+        int fds[2];
+        if (pipe(fds) != 0)
+            throw std::runtime_error(std::string("sweep pipe failed: ") + strerror(errno));
+        pid_t pid = fork();
+        if (pid < 0)
+            throw std::runtime_error(std::string("sweep fork failed: ") + strerror(errno));
+        if (pid == 0) {
+            close(fds[0]);
+            std::string row;
+            int code = 0;
+            try {
+                root_config point_cfg = cfg;
+                size_t index          = point;
+                for (auto &dim : dims) {
+                    point_cfg[dim.section].cfg[dim.key] = dim.values[index % dim.values.size()];
+                    index /= dim.values.size();
+                }
+                model->reconfigure(point_cfg);
+                replay.reopen(tail_at);
+                window_replay::window_stats stats;
+                replay.simulate(std::numeric_limits<size_t>::max(), &stats);
+                replay.finish();
+                std::ostringstream out;
+                out << std::fixed << stats.requests << "," << replay.curr_clk - prefix_clk << ","
+                    << stats.bandwidth(tCK) << "," << stats.read_latency(tCK) << "," << stats.write_latency(tCK);
+                row = out.str();
+            } catch (std::exception &e) {
+                row  = e.what();
+                code = 1;
+            }
+            if (write(fds[1], row.data(), row.size()) < 0)
+                code = 1;
+            /* Skip destructors, the dumps belong to the parent */
+            _exit(code);
+        }
+        close(fds[1]);
+        running[pid] = {point, fds[0]};
+    }
+    while (!running.empty())
+        collect();
+
+    auto sim_end      = std::chrono::high_resolution_clock::now();
+    auto sim_duration = std::chrono::duration_cast<std::chrono::seconds>(sim_end - sim_start).count();
+
+    std::string name     = dump_cfg.check("sweep_dump") ? dump_cfg["sweep_dump"] : "sweep.csv";
+    std::string filename = dump_cfg["path"] + "/" + name;
+    std::ofstream table(filename);
+    if (!table.good())
+        throw std::runtime_error("cannot open sweep dump file: " + filename);
+    table << "point";
+    for (auto &dim : dims)
+        table << "," << dim.section << "." << dim.key;
+    table << ",requests,clock,bandwidth_gbps,read_latency_ns,write_latency_ns\n";
+    for (size_t point = 0; point < points; point++) {
+        table << point;
+        size_t index = point;
+        for (auto &dim : dims) {
+            table << "," << dim.values[index % dim.values.size()];
+            index /= dim.values.size();
+        }
+        table << "," << results[point] << "\n";
+        std::cout << "Sweep point " << point << " [" << point_label(point) << "]: " << results[point] << std::endl;
+    }
+    std::cout << "Sweep points: " << points << ", columns: requests, clock, bandwidth GB/s, read latency ns, write "
+              << "latency ns, written to " << filename << std::endl;
+    std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
+}
+
+/* Frontend state of one core in `run_multicore_trace`
+ *   Reads hold an MSHR entry until their callback, and stay in the reorder window until every older read is done.
+ *   Writes (including clwb/ntstore) are posted, an sfence waits for all outstanding reads of the core.
+ */
+struct core {
+    std::unique_ptr<trace> trace_file;
+    bool trace_end       = false;
+    bool has_request     = false;
+    bool critical_stall  = false;
+    size_t critical_read = 0; /* Read index of the critical load being waited for */
+    clk_t idle_until     = 0;
+
+    /* The trace request waiting to be issued */
+    logic_addr_t addr      = 0;
+    base_request_type type = base_request_type::read;
+    bool critical          = false;
+    persist_op persist     = persist_op::none;
+    clk_t idle_clk         = clk_invalid;
+
+    /* Outstanding reads in issue order: (trace sequence number, done) */
+    size_t next_seq = 0;
+    size_t rob_head = 0; /* Read index of rob.front() */
+    size_t reads    = 0; /* Read index of the next read */
+    std::deque<std::pair<size_t, bool>> rob;
+    size_t mshr_used = 0;
+
+    /* Stats */
+    size_t writes          = 0;
+    clk_t read_latency_sum = 0;
+    clk_t read_latency_max = 0;
+    clk_t mshr_stall_clk   = 0;
+    clk_t rob_stall_clk    = 0;
+    clk_t last_clk         = 0;
+
+    void read_done(size_t read_index, clk_t arrive, clk_t curr_clk)
+    {
+        rob[read_index - rob_head].second = true;
+        while (!rob.empty() && rob.front().second) {
+            rob.pop_front();
+            rob_head++;
+        }
+        mshr_used--;
+        if (critical_stall && read_index == critical_read)
+            critical_stall = false;
+
+        clk_t latency = curr_clk - arrive;
+        read_latency_sum += latency;
+        read_latency_max = std::max(read_latency_max, latency);
+        last_clk         = std::max(last_clk, curr_clk);
+    }
+};
+
+void run_multicore_trace(root_config &cfg,
+                         const std::vector<std::string> &trace_filenames,
+                         std::shared_ptr<base_component> model)
+{
+    auto heart_beat_epoch = cfg["trace"].get_ulong("heart_beat_epoch");
+    size_t mshr_entries   = cfg["trace"].check("mshr_entries") ? cfg["trace"].get_ulong("mshr_entries") : 10;
+    size_t reorder_window = cfg["trace"].check("reorder_window") ? cfg["trace"].get_ulong("reorder_window") : 64;
+    double tCK            = std::stod(cfg["basic"]["tCK"]);
+    if (mshr_entries == 0 || reorder_window == 0)
+        throw std::runtime_error("[trace] mshr_entries and reorder_window should be larger than 0.");
+    for (const auto &key : {"checkpoint_save", "checkpoint_restore"}) {
+        if (cfg["trace"].check(key) && cfg["trace"][key] != "none")
+            throw std::runtime_error(std::string("[trace] ") + key + " is only supported with a single trace.");
+    }
+    if (cfg["trace"].check("sample_period") && cfg["trace"].get_ulong("sample_period") != 0)
+        throw std::runtime_error("[trace] sample_period is only supported with a single trace.");
+    if (cfg["trace"].check("simpoint_file") && cfg["trace"]["simpoint_file"] != "none")
+        throw std::runtime_error("[trace] simpoint_file is only supported with a single trace.");
+    if (cfg["trace"].check("parallel_segments") && cfg["trace"].get_ulong("parallel_segments") > 1)
+        throw std::runtime_error("[trace] parallel_segments is only supported with a single trace.");
+    if (cfg["trace"].check("sweep") && cfg["trace"]["sweep"] != "none")
+        throw std::runtime_error("[trace] sweep is only supported with a single trace.");
+
+    histogram hist_read_latency("trace", "read_latency");
+    histogram hist_write_latency("trace", "write_latency");
+
+    std::vector<core> cores(trace_filenames.size());
+    for (size_t i = 0; i < cores.size(); i++)
+        cores[i].trace_file = std::make_unique<trace>(trace_filenames[i]);
+
+    auto tick_core = [&](core &c, clk_t curr_clk) {
+        if (c.trace_end || c.critical_stall || curr_clk < c.idle_until)
+            return;
+
+        if (!c.has_request) {
+            do {
+                c.trace_end =
+                    !c.trace_file->get_dram_trace_request(c.addr, c.type, c.critical, c.persist, c.idle_clk);
+            } while (!c.trace_end && c.persist == persist_op::marker);
+            if (c.trace_end)
+                return;
+            c.has_request = true;
+        }
+
+        if (c.persist == persist_op::sfence) {
+            if (c.mshr_used == 0) {
+                c.has_request = false;
+                c.next_seq++;
+            }
+            return;
+        }
+
+        bool is_read = c.type == base_request_type::read;
+        if (!c.rob.empty() && c.next_seq - c.rob.front().first >= reorder_window) {
+            c.rob_stall_clk++;
+            return;
+        }
+        if (is_read && c.mshr_used >= mshr_entries) {
+            c.mshr_stall_clk++;
+            return;
+        }
+
+        base_request req(c.type, c.addr, curr_clk);
+        if (is_read) {
+            req.callback = [&, read_index = c.reads, curr_clk](logic_addr_t logic_addr, clk_t clk) {
+                hist_read_latency.record(clk > curr_clk ? clk - curr_clk : 0);
+                c.read_done(read_index, curr_clk, clk);
+            };
+        } else {
+            req.callback = [&, curr_clk](logic_addr_t logic_addr, clk_t clk) {
+                hist_write_latency.record(clk > curr_clk ? clk - curr_clk : 0);
+            };
+        }
+        if (!std::get<0>(model->issue_request(req)))
+            return;
+
+        if (is_read) {
+            c.rob.emplace_back(c.next_seq, false);
+            c.critical_stall = c.critical;
+            c.critical_read  = c.reads;
+            c.reads++;
+            c.mshr_used++;
+        } else {
+            c.writes++;
+        }
+        c.next_seq++;
+        c.has_request = false;
+        c.last_clk    = std::max(c.last_clk, curr_clk);
+        if (c.idle_clk != clk_invalid)
+            c.idle_until = curr_clk + 1 + c.idle_clk;
+    };
+
+    clk_t curr_clk = 0;
+    auto sim_start = std::chrono::high_resolution_clock::now();
+
+    /* Cores take turns to issue first, so no core is always favored when the model is full */
+    auto all_end = [&cores]() {
+        return std::all_of(cores.begin(), cores.end(), [](const core &c) { return c.trace_end; });
+    };
+    while (!all_end()) {
+        for (size_t i = 0; i < cores.size(); i++)
+            tick_core(cores[(curr_clk + i) % cores.size()], curr_clk);
+        model->tick(curr_clk);
+        curr_clk++;
+        if (heart_beat_epoch != 0 && curr_clk % heart_beat_epoch == 0) {
+            std::cout << "Trace heart beat: " << curr_clk << std::endl;
+        }
+    }
+    clk_t last_trace_clk = curr_clk;
+
+    model->drain();
+
+    while (model->pending()) {
+        model->tick(curr_clk);
+        curr_clk++;
+        if (heart_beat_epoch != 0 && curr_clk % heart_beat_epoch == 0) {
+            std::cout << "Trace heart beat: " << curr_clk << std::endl;
+        }
+    }
+
+    auto sim_end      = std::chrono::high_resolution_clock::now();
+    auto sim_duration = std::chrono::duration_cast<std::chrono::seconds>(sim_end - sim_start).count();
+
+    model->print_counters();
+
+    std::cout << "Total clock: " << curr_clk << std::endl;
+    std::cout << "Last command clock: " << last_trace_clk << std::endl;
+    std::cout << "Total ns: " << std::fixed << double(curr_clk) * tCK << std::endl;
+    std::cout << "Last command ns: " << std::fixed << double(last_trace_clk) * tCK << std::endl;
+    print_latency_histograms({&hist_read_latency, &hist_write_latency});
+    for (size_t i = 0; i < cores.size(); i++) {
+        auto &c   = cores[i];
+        double ns = double(c.last_clk + 1) * tCK;
+        std::string prefix = "Core " + std::to_string(i) + " ";
+        std::cout << prefix << "reads: " << c.reads << std::endl;
+        std::cout << prefix << "writes: " << c.writes << std::endl;
+        std::cout << prefix << "read latency avg ns: " << std::fixed
+                  << (c.reads == 0 ? 0.0 : double(c.read_latency_sum) / c.reads * tCK) << std::endl;
+        std::cout << prefix << "read latency max ns: " << std::fixed << double(c.read_latency_max) * tCK << std::endl;
+        std::cout << prefix << "bandwidth GB/s: " << std::fixed << double((c.reads + c.writes) * cpu_cl_size) / ns
+                  << std::endl;
+        std::cout << prefix << "mshr stall clk: " << c.mshr_stall_clk << std::endl;
+        std::cout << prefix << "reorder window stall clk: " << c.rob_stall_clk << std::endl;
+    }
     std::cout << "Simulation time: " << sim_duration << " secs" << std::endl;
 }
 
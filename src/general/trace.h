@@ -5,10 +5,20 @@
 #include "config.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace vans::trace
 {
 
+/* Persistence operations in the trace:
+ *   `F`: clwb, write back a cache line without blocking the frontend
+ *   `N`: ntstore, non-temporal store without blocking the frontend
+ *   `S`: sfence, block the frontend until every earlier write is in the persistence domain
+ * and a marker, which is not a request:
+ *   `M`: ends the fast-forward of `[trace] fast_forward : marker`, ignored otherwise
+ */
+enum class persist_op { none, clwb, ntstore, sfence, marker };
+
 class trace
 {
   private:
@@ -16,6 +26,9 @@ class trace
     std::string name;
 
   public:
+    /* Requests read so far, the trace offset of a checkpoint */
+    size_t records = 0;
+
     trace()              = delete;
     trace(const trace &) = delete;
 
@@ -28,11 +41,88 @@ class trace
 
     virtual ~trace() = default;
 
-    bool get_dram_trace_request(logic_addr_t &addr, base_request_type &type, bool &critical, clk_t &idle_clk_injection);
+    bool get_dram_trace_request(logic_addr_t &addr,
+                                base_request_type &type,
+                                bool &critical,
+                                persist_op &persist,
+                                clk_t &idle_clk_injection);
+
+    /* Skip the first `count` requests, return false if the trace is shorter */
+    bool skip(size_t count);
+
+    [[nodiscard]] std::streampos tell()
+    {
+        return file.tellg();
+    }
+
+    /* Continue from `pos` with a new file descriptor, a forked child shares the file offset with its parent */
+    void reopen(std::streampos pos)
+    {
+        file.close();
+        file.open(name);
+        file.seekg(pos);
+        if (!file.good())
+            throw std::runtime_error("Trace file reopen failed.");
+    }
 };
 
+/* Replay one trace into the model
+ *   With `[trace] fast_forward`, the first requests (or the requests before the first marker) only warm the model,
+ *   see `base_component::warm`, one clk per request. Detailed simulation starts after them.
+ *   With `[trace] checkpoint_save`, the model is saved once `checkpoint_at_request` requests are issued or
+ *   `checkpoint_at_clk` is reached, after every issued request finishes. With `checkpoint_restore`, the replay resumes
+ *   from a saved model, skipping the requests before the checkpoint if `checkpoint_skip_trace` is 1, or replaying the
+ *   trace from its start as a new tail otherwise.
+ */
 void run_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model);
 
+/* Sampled replay (SMARTS style), enabled by `[trace] sample_period`
+ *   Every `sample_period` requests, the trace warms the model functionally, then `sample_warmup` requests are
+ *   simulated in detail to fill the queues and the next `sample_window` requests are measured. Each window reports
+ *   its bandwidth and latency, and the run reports their means with 95% confidence intervals, plus the number of
+ *   windows needed to reach `sample_target_error`. Persistence fences are not modeled, clwb/ntstore are writes.
+ */
+void run_sampled_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model);
+
+/* Replay of representative intervals, enabled by `[trace] simpoint_file`
+ *   The file (see `simpoint.h`, written by `vans_simpoint`) lists weighted intervals of the trace. Each interval is
+ *   simulated in detail after functionally warming the `simpoint_warmup` requests before it (every earlier request if
+ *   0), and the run reports the weighted bandwidth and latency, plus the estimated clocks of the whole trace.
+ */
+void run_simpoint_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model);
+
+using model_factory_f = std::function<std::shared_ptr<base_component>(const root_config &cfg)>;
+
+/* Parallel replay, enabled by `[trace] parallel_segments` larger than 1
+ *   The trace is split into `parallel_segments` contiguous segments of requests, simulated on `parallel_threads`
+ *   threads, each segment on its own component tree from `make_model`. A segment first warms its tree functionally with
+ *   the `parallel_overlap` requests before it. `model` simulates the first segment and keeps the dumps, the counters
+ *   and histograms of every segment are summed into it, and the segment clocks add up to the total clock.
+ *   Like the sampled frontends, fences are not modeled, clwb/ntstore are writes.
+ */
+void run_parallel_trace(root_config &cfg,
+                        std::string &trace_filename,
+                        std::shared_ptr<base_component> model,
+                        const model_factory_f &make_model);
+
+/* Parameter sweep, enabled by `[trace] sweep`: `section.key=v1,v2,...;section.key=...`
+ *   The first `sweep_prefix` requests are simulated once, then one child process per combination of the values is
+ *   forked (up to `sweep_jobs` at a time), so the warm model is shared copy-on-write. A child sets its values,
+ *   reconfigures the model (latencies, thresholds and DRAM timings, see `base_component::reconfigure`) and simulates
+ *   the rest of the trace. The tail results of all points go to one table, `[dump] sweep_dump`. Keys that the
+ *   reconfiguration does not re-read, e.g. sizes, cannot be swept, see `base_component::reconfigure_keys`.
+ *   Like the sampled frontends, fences are not modeled, clwb/ntstore are writes.
+ */
+void run_sweep_trace(root_config &cfg, std::string &trace_filename, std::shared_ptr<base_component> model);
+
+/* Replay one trace per core, interleaved round-robin into the model
+ *   Each core keeps at most `[trace] mshr_entries` reads outstanding, and stops issuing when its oldest outstanding
+ *   read is `[trace] reorder_window` trace requests behind the next one (a full reorder buffer).
+ */
+void run_multicore_trace(root_config &cfg,
+                         const std::vector<std::string> &trace_filenames,
+                         std::shared_ptr<base_component> model);
+
 } // namespace vans::trace
 
 #endif // VANS_TRACE_H
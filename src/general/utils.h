@@ -3,7 +3,10 @@
 #define VANS_UTILS_H
 
 #include "common.h"
+#include <array>
+#include <algorithm>
 #include <cerrno>
+#include <cmath>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -16,6 +19,8 @@
 #include <utility>
 #include <vector>
 
+#include "async_writer.h"
+#include "checkpoint.h"
 #include "config.h"
 
 namespace vans
@@ -23,13 +28,16 @@ namespace vans
 
 namespace dram
 {
+/* Upper bound of address levels among all supported DRAM standards */
+enum : size_t { max_levels = 8 };
+
 using addr_t        = uint64_t *;
-using mapped_addr_t = std::vector<uint64_t>;
+using mapped_addr_t = std::array<uint64_t, max_levels>;
 using addr_type_t   = struct addr_type {
-    logic_addr_t logic_addr;
-    mapped_addr_t mapped_addr;
+    logic_addr_t logic_addr   = addr_invalid;
+    mapped_addr_t mapped_addr = {0};
 
-    explicit addr_type(mapped_addr_t mapped_addr) : mapped_addr(std::move(mapped_addr)) {}
+    explicit addr_type(const mapped_addr_t &mapped_addr) : mapped_addr(mapped_addr) {}
     explicit addr_type(logic_addr_t logic_addr) : logic_addr(logic_addr) {}
 };
 } // namespace dram
@@ -49,11 +57,11 @@ static inline size_t log2(size_t val)
 }
 
 
-/* Dumper */
+/* Dumper: file output is buffered by an `async_writer`, console output is not flushed per line */
 class dumper
 {
   private:
-    std::ofstream dump_file;
+    std::unique_ptr<async_writer> dump_file;
     bool dump_to_file;
     bool dump_to_cli;
 
@@ -82,29 +90,23 @@ class dumper
                     throw std::runtime_error(strerror(errno));
                 }
             }
-            dump_file.open(filename);
-            if (!dump_file.good())
-                throw std::runtime_error("cannot open dump file: " + filename);
+            dump_file = std::make_unique<async_writer>(filename);
         }
     }
 
-    virtual ~dumper()
-    {
-        if (dump_to_file)
-            dump_file.close();
-    }
+    virtual ~dumper() = default;
 
     void dump(const char *const msg, bool newline = true)
     {
         if (dump_to_cli) {
             std::cout << msg;
             if (newline)
-                std::cout << std::endl;
+                std::cout << '\n';
         }
         if (dump_to_file) {
-            dump_file << msg;
+            dump_file->write(msg, strlen(msg));
             if (newline)
-                dump_file << std::endl;
+                dump_file->write("\n", 1);
         }
     }
 
@@ -130,9 +132,16 @@ static dumper::type get_dump_type(const root_config &cfg)
                                  + "] is illegal, should be [none|file|cli|both]");
 }
 
-static std::string get_dump_filename(const root_config &cfg, const std::string &name, unsigned id)
+/* A `[dump]` file key is enabled unless it is missing or `none` */
+static bool dump_enabled(const root_config &cfg, const std::string &key)
+{
+    return cfg["dump"].check(key) && cfg["dump"][key] != "none";
+}
+
+static std::string
+get_dump_filename(const root_config &cfg, const std::string &name, unsigned id, const std::string &component = "")
 {
-    std::string filename = cfg["dump"][name] + "_" + std::to_string(id);
+    std::string filename = cfg["dump"][name] + "_" + (component.empty() ? "" : component + "_") + std::to_string(id);
     std::string path     = cfg["dump"]["path"];
     return path + "/" + filename;
 }
@@ -143,31 +152,158 @@ class counter
   public:
     std::string domain;     /* e.g. RMW or AIT */
     std::string sub_domain; /* e.g. events or duration */
-    std::map<std::string, size_t> counters;
+    /* Counter values are contiguous, so a snapshot is one copy, see `epoch_stats` */
+    std::map<std::string, size_t> index;
+    std::vector<size_t> values;
 
     counter() = delete;
     counter(std::string domain, std::string sub_domain, const std::vector<std::string> &counter_names) :
         domain(std::move(domain)), sub_domain(std::move(sub_domain))
     {
         for (const auto &name : counter_names)
-            this->counters[name] = 0;
+            this->index.emplace(name, this->index.size());
+        this->values.assign(this->index.size(), 0);
     }
 
     void print(const std::shared_ptr<dumper> &d)
     {
         std::string prefix = "cnt." + domain + "." + sub_domain + ".";
-        for (const auto &cnt : counters) {
-            d->dump(prefix + cnt.first + ": " + std::to_string(cnt.second));
+        for (const auto &cnt : index) {
+            d->dump(prefix + cnt.first + ": " + std::to_string(values[cnt.second]));
         }
     }
 
     size_t &operator[](const std::string &name)
     {
-        return this->counters.at(name);
+        return this->values[this->index.at(name)];
+    }
+
+    /* Add the values of the same counter of another component tree, e.g. a segment of a parallel run */
+    void merge(const counter &other)
+    {
+        if (other.domain != domain || other.sub_domain != sub_domain || other.values.size() != values.size())
+            throw std::runtime_error("Internal error, merging counter " + other.domain + "." + other.sub_domain
+                                     + " into " + domain + "." + sub_domain);
+        for (size_t i = 0; i < values.size(); i++)
+            values[i] += other.values[i];
+    }
+
+    void serialize(checkpoint &ckpt)
+    {
+        ckpt.tag(domain + "." + sub_domain);
+        auto size = values.size();
+        ckpt.io(values);
+        if (values.size() != size)
+            throw std::runtime_error("checkpoint counter " + domain + "." + sub_domain + " has a different size.");
     }
 };
 
 
+/* Latency histogram with log-linear (HDR style) buckets
+ *   Values below `sub_buckets` have their own bucket, every larger power of 2 range is split into `sub_buckets` linear
+ *   buckets, so a bucket is narrower than 1/sub_buckets of its values. Recording is one bucket increment.
+ */
+class histogram
+{
+  private:
+    enum : size_t {
+        sub_bucket_bits = 5,
+        sub_buckets     = 1 << sub_bucket_bits,
+        total_buckets   = (64 - sub_bucket_bits + 1) * sub_buckets,
+    };
+
+    std::vector<size_t> buckets;
+    size_t total_count = 0;
+    uint64_t sum       = 0;
+    uint64_t max       = 0;
+
+    static size_t bucket_index(uint64_t value)
+    {
+        if (value < sub_buckets)
+            return value;
+        size_t msb   = 63 - __builtin_clzll(value);
+        size_t shift = msb - sub_bucket_bits;
+        return (shift + 1) * sub_buckets + (value >> shift) - sub_buckets;
+    }
+
+    /* Largest value that falls into bucket `index` */
+    static uint64_t bucket_max(size_t index)
+    {
+        if (index < sub_buckets)
+            return index;
+        size_t shift = index / sub_buckets - 1;
+        uint64_t sub = index % sub_buckets + sub_buckets;
+        return ((sub + 1) << shift) - 1;
+    }
+
+  public:
+    std::string domain;
+    std::string sub_domain;
+
+    histogram() = delete;
+    histogram(std::string domain, std::string sub_domain) :
+        buckets(total_buckets, 0), domain(std::move(domain)), sub_domain(std::move(sub_domain))
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        buckets[bucket_index(value)]++;
+        total_count++;
+        sum += value;
+        max = std::max(max, value);
+    }
+
+    [[nodiscard]] size_t count() const
+    {
+        return total_count;
+    }
+
+    /* Upper bound of the smallest bucket holding at least `ratio` of all values */
+    [[nodiscard]] uint64_t percentile(double ratio) const
+    {
+        if (total_count == 0)
+            return 0;
+        auto rank    = std::max(size_t(1), size_t(std::ceil(ratio * double(total_count))));
+        size_t accum = 0;
+        for (size_t i = 0; i < total_buckets; i++) {
+            accum += buckets[i];
+            if (accum >= rank)
+                return std::min(bucket_max(i), max);
+        }
+        return max;
+    }
+
+    void merge(const histogram &other)
+    {
+        for (size_t i = 0; i < total_buckets; i++)
+            buckets[i] += other.buckets[i];
+        total_count += other.total_count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    void print(const std::shared_ptr<dumper> &d) const
+    {
+        std::string prefix = "hist." + domain + "." + sub_domain + ".";
+        d->dump(prefix + "count: " + std::to_string(total_count));
+        d->dump(prefix + "avg: " + std::to_string(total_count == 0 ? 0.0 : double(sum) / double(total_count)));
+        d->dump(prefix + "p50: " + std::to_string(percentile(0.5)));
+        d->dump(prefix + "p90: " + std::to_string(percentile(0.9)));
+        d->dump(prefix + "p99: " + std::to_string(percentile(0.99)));
+        d->dump(prefix + "p99.9: " + std::to_string(percentile(0.999)));
+        d->dump(prefix + "max: " + std::to_string(max));
+    }
+
+    void serialize(checkpoint &ckpt)
+    {
+        ckpt.io(buckets);
+        ckpt.io(total_count);
+        ckpt.io(sum);
+        ckpt.io(max);
+    }
+};
+
 /* RMW related utils, for 256 byte entries */
 namespace rmw
 {
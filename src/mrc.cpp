@@ -0,0 +1,95 @@
+#include "config.h"
+#include "general/mrc.h"
+#include "general/trace.h"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/* LRU miss ratio curves of the rmw (256B) and ait (4KB) buffers of every DIMM, in one pass over the trace
+ *   `[trace] mrc_sample_blocks` samples 1 in N blocks (SHARDS), 1 gives exact curves.
+ */
+int main(int argc, char *argv[])
+{
+    string trace_filename;
+    string config_filename;
+    string output_filename;
+
+    int c;
+    while (-1 != (c = getopt(argc, argv, "c:t:o:"))) {
+        switch (c) {
+        case 'c':
+            config_filename = optarg;
+            break;
+        case 't':
+            trace_filename = optarg;
+            break;
+        case 'o':
+            output_filename = optarg;
+            break;
+        default:
+            cout << "Usage: "
+                 << "-c cfg_filename -t trace_filename [-o mrc_filename]" << endl;
+            return 0;
+        }
+    }
+
+    if (trace_filename.empty() || config_filename.empty()) {
+        cout << "Usage: "
+             << "-c cfg_filename -t trace_filename [-o mrc_filename]" << endl;
+        return 0;
+    }
+
+    try {
+        auto cfg       = vans::root_config(config_filename);
+        auto &dump_cfg = cfg["dump"];
+        if (output_filename.empty()) {
+            /* The default output goes to the dump dir, create it as the dumpers do */
+            if (mkdir(dump_cfg["path"].c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) == -1 && errno != EEXIST)
+                throw std::runtime_error("cannot create the dump dir " + dump_cfg["path"] + ": " + strerror(errno));
+            output_filename = dump_cfg["path"] + "/" + (dump_cfg.check("mrc_dump") ? dump_cfg["mrc_dump"] : "mrc.csv");
+        }
+        size_t sample_blocks =
+            cfg["trace"].check("mrc_sample_blocks") ? cfg["trace"].get_ulong("mrc_sample_blocks") : 1;
+
+        vans::trace::trace trace(trace_filename);
+        vans::mrc::analyzer analyzer(cfg, sample_blocks);
+
+        vans::logic_addr_t addr;
+        vans::base_request_type type;
+        bool critical;
+        vans::trace::persist_op persist;
+        vans::clk_t idle_clk_injection;
+        while (trace.get_dram_trace_request(addr, type, critical, persist, idle_clk_injection)) {
+            if (persist == vans::trace::persist_op::sfence || persist == vans::trace::persist_op::marker)
+                continue;
+            analyzer.add(addr);
+        }
+        analyzer.write_csv(output_filename);
+
+        /* Miss ratios of the configured buffers */
+        size_t entries[] = {cfg["rmw"].get_ulong("buffer_entries"), cfg["ait"].get_ulong("buffer_entries")};
+        for (size_t d = 0; d < analyzer.streams.size(); d++) {
+            for (size_t l = 0; l < size_t(vans::mrc::level::total); l++) {
+                auto &s = analyzer.streams[d][l];
+                cout << "DIMM " << d << " " << vans::mrc::level_name[l] << ": " << s.size() << " accesses, miss ratio "
+                     << fixed << setprecision(4) << s.miss_ratio(entries[l]) << " at buffer_entries " << entries[l]
+                     << endl;
+            }
+        }
+        cout << "Miss ratio curves (1 in " << sample_blocks << " blocks sampled) written to " << output_filename
+             << endl;
+        return 0;
+    } catch (const std::exception &e) {
+        cerr << "vans_mrc: " << e.what() << endl;
+        cerr << "Usage: "
+             << "-c cfg_filename -t trace_filename [-o mrc_filename]" << endl;
+        return 1;
+    }
+}
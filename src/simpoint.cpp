@@ -0,0 +1,87 @@
+#include "config.h"
+#include "general/simpoint.h"
+#include "general/trace.h"
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+/* Pre-pass of `[trace] simpoint_file`: split the trace into intervals of `simpoint_interval` requests, cluster their
+ * signatures and write the weighted representative intervals. A last partial interval is not a candidate.
+ */
+int main(int argc, char *argv[])
+{
+    string trace_filename;
+    string config_filename;
+    string output_filename;
+
+    int c;
+    while (-1 != (c = getopt(argc, argv, "c:t:o:"))) {
+        switch (c) {
+        case 'c':
+            config_filename = optarg;
+            break;
+        case 't':
+            trace_filename = optarg;
+            break;
+        case 'o':
+            output_filename = optarg;
+            break;
+        default:
+            cout << "Usage: "
+                 << "-c cfg_filename -t trace_filename [-o simpoint_filename]" << endl;
+            return 0;
+        }
+    }
+
+    if (trace_filename.empty() || config_filename.empty()) {
+        cout << "Usage: "
+             << "-c cfg_filename -t trace_filename [-o simpoint_filename]" << endl;
+        return 0;
+    }
+
+    auto cfg        = vans::root_config(config_filename);
+    auto &trace_cfg = cfg["trace"];
+    if (output_filename.empty())
+        output_filename = trace_cfg.check("simpoint_file") ? trace_cfg["simpoint_file"] : "none";
+    if (output_filename == "none") {
+        cout << "No output file, set `-o` or `[trace] simpoint_file`" << endl;
+        return 1;
+    }
+    size_t interval = trace_cfg.check("simpoint_interval") ? trace_cfg.get_ulong("simpoint_interval") : 100000;
+    size_t clusters = trace_cfg.check("simpoint_clusters") ? trace_cfg.get_ulong("simpoint_clusters") : 10;
+    if (interval == 0 || clusters == 0) {
+        cout << "[trace] simpoint_interval and simpoint_clusters should be larger than 0" << endl;
+        return 1;
+    }
+
+    vans::trace::trace trace(trace_filename);
+    vans::simpoint::signature_builder builder(cfg);
+    vector<vans::simpoint::point_t> signatures;
+
+    vans::logic_addr_t addr;
+    vans::base_request_type type;
+    bool critical;
+    vans::trace::persist_op persist;
+    vans::clk_t idle_clk_injection;
+    while (trace.get_dram_trace_request(addr, type, critical, persist, idle_clk_injection)) {
+        /* Intervals count requests the same way as `run_simpoint_trace` */
+        if (persist == vans::trace::persist_op::sfence || persist == vans::trace::persist_op::marker)
+            continue;
+        builder.add(addr, type);
+        if (builder.size() == interval)
+            signatures.push_back(builder.finish());
+    }
+
+    auto reps = vans::simpoint::select(signatures, clusters);
+    vans::simpoint::write_file(output_filename, interval, signatures.size(), reps);
+
+    cout << "Intervals: " << signatures.size() << " of " << interval << " requests" << endl;
+    cout << "Representative intervals: " << reps.size() << endl;
+    for (auto &r : reps)
+        cout << "Interval " << r.interval << " weight " << r.weight << endl;
+    cout << "Written to " << output_filename << endl;
+    return 0;
+}
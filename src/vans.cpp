@@ -4,12 +4,13 @@
 #include <iostream>
 #include <string>
 #include <unistd.h>
+#include <vector>
 
 using namespace std;
 
 int main(int argc, char *argv[])
 {
-    string trace_filename;
+    vector<string> trace_filenames;
     string config_filename;
 
     int c;
@@ -19,18 +20,41 @@ int main(int argc, char *argv[])
             config_filename = optarg;
             break;
         case 't':
-            trace_filename = optarg;
+            trace_filenames.emplace_back(optarg);
             break;
         default:
             cout << "Usage: "
-                 << "-c cfg_filename -t trace_filename" << endl;
+                 << "-c cfg_filename -t trace_filename [-t trace_filename ...]" << endl;
             return 0;
         }
     }
 
+    if (trace_filenames.empty()) {
+        cout << "Usage: "
+             << "-c cfg_filename -t trace_filename [-t trace_filename ...]" << endl;
+        return 0;
+    }
+
     auto cfg   = vans::root_config(config_filename);
     auto model = vans::factory::make(cfg);
-    vans::trace::run_trace(cfg, trace_filename, model);
+    /* One `-t` per core, a single trace keeps the single stream frontend */
+    auto &trace_cfg = cfg["trace"];
+    bool sampled    = trace_cfg.check("sample_period") && trace_cfg.get_ulong("sample_period") != 0;
+    bool simpoint   = trace_cfg.check("simpoint_file") && trace_cfg["simpoint_file"] != "none";
+    bool parallel   = trace_cfg.check("parallel_segments") && trace_cfg.get_ulong("parallel_segments") > 1;
+    bool sweep      = trace_cfg.check("sweep") && trace_cfg["sweep"] != "none";
+    if (trace_filenames.size() > 1)
+        vans::trace::run_multicore_trace(cfg, trace_filenames, model);
+    else if (simpoint)
+        vans::trace::run_simpoint_trace(cfg, trace_filenames[0], model);
+    else if (sampled)
+        vans::trace::run_sampled_trace(cfg, trace_filenames[0], model);
+    else if (parallel)
+        vans::trace::run_parallel_trace(cfg, trace_filenames[0], model, vans::factory::make);
+    else if (sweep)
+        vans::trace::run_sweep_trace(cfg, trace_filenames[0], model);
+    else
+        vans::trace::run_trace(cfg, trace_filenames[0], model);
 
     return 0;
 }